@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-1 block transform using the ARMv8 Crypto Extensions, if the CPU
+ * implements them
+ */
+
+#include <common.h>
+#include <u-boot/sha1.h>
+
+/* ID_AA64ISAR0_EL1.SHA1, non-zero if SHA1C and friends are implemented */
+#define ID_AA64ISAR0_SHA1_SHIFT	8
+#define ID_AA64ISAR0_SHA1_MASK	0xf
+
+void sha1_armv8_ce_process(uint32_t state[5], const uint8_t *src,
+			   uint32_t blocks);
+
+static bool sha1_armv8_ce_present(void)
+{
+	u64 isar0;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return (isar0 >> ID_AA64ISAR0_SHA1_SHIFT) & ID_AA64ISAR0_SHA1_MASK;
+}
+
+void sha1_process(sha1_context *ctx, const unsigned char *data,
+		  unsigned int blocks)
+{
+	uint32_t state[5];
+	int i;
+
+	if (!blocks)
+		return;
+
+	if (!sha1_armv8_ce_present()) {
+		sha1_process_generic(ctx, data, blocks);
+		return;
+	}
+
+	/* The context keeps the state in longs, which are 64-bit here */
+	for (i = 0; i < ARRAY_SIZE(state); i++)
+		state[i] = ctx->state[i];
+	sha1_armv8_ce_process(state, data, blocks);
+	for (i = 0; i < ARRAY_SIZE(state); i++)
+		ctx->state[i] = state[i];
+}
@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * SHA-256 block transform using the ARMv8 Crypto Extensions, if the CPU
+ * implements them
+ */
+
+#include <common.h>
+#include <u-boot/sha256.h>
+
+/* ID_AA64ISAR0_EL1.SHA2, non-zero if SHA256H and friends are implemented */
+#define ID_AA64ISAR0_SHA2_SHIFT	12
+#define ID_AA64ISAR0_SHA2_MASK	0xf
+
+void sha256_armv8_ce_process(uint32_t state[8], const uint8_t *src,
+			     uint32_t blocks);
+
+static bool sha256_armv8_ce_present(void)
+{
+	u64 isar0;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return (isar0 >> ID_AA64ISAR0_SHA2_SHIFT) & ID_AA64ISAR0_SHA2_MASK;
+}
+
+void sha256_process(sha256_context *ctx, const uint8_t *data, uint32_t blocks)
+{
+	if (!blocks)
+		return;
+
+	if (sha256_armv8_ce_present())
+		sha256_armv8_ce_process(ctx->state, data, blocks);
+	else
+		sha256_process_generic(ctx, data, blocks);
+}
@@ -50,7 +50,8 @@ struct tegra_mmc {
 	unsigned short	setinterr;	/* offset 52h */
 	unsigned char	admaerr;	/* offset 54h */
 	unsigned char	res4[3];	/* RESERVED, offset 55h-57h */
-	unsigned long	admaaddr;	/* offset 58h-5Fh */
+	unsigned int	admaaddr;	/* offset 58h-5Bh */
+	unsigned int	admaaddr_hi;	/* offset 5Ch-5Fh */
 	unsigned char	res5[0x9c];	/* RESERVED, offset 60h-FBh */
 	unsigned short	slotintstatus;	/* offset FCh */
 	unsigned short	hcver;		/* HOST Version */
@@ -80,6 +81,9 @@ struct tegra_mmc {
 #define TEGRA_MMC_HOSTCTL_DMASEL_ADMA2_32BIT			(2 << 3)
 #define TEGRA_MMC_HOSTCTL_DMASEL_ADMA2_64BIT			(3 << 3)
 
+#define TEGRA_MMC_CAPAREG_ADMA2					(1 << 19)
+#define TEGRA_MMC_CAPAREG_64BIT					(1 << 28)
+
 #define TEGRA_MMC_TRNMOD_DMA_ENABLE				(1 << 0)
 #define TEGRA_MMC_TRNMOD_BLOCK_COUNT_ENABLE			(1 << 1)
 #define TEGRA_MMC_TRNMOD_DATA_XFER_DIR_SEL_WRITE		(0 << 4)
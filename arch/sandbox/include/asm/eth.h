@@ -82,6 +82,12 @@ typedef int sandbox_eth_tx_hand_f(struct udevice *dev, void *pkt,
  * recv_packets - number of packets returned
  * tx_handler - function to generate responses to sent packets
  * priv - a pointer to some structure a test may want to keep track of
+ * offload - Act like hardware with checksum offload and a lent tx buffer: drop
+ *	     received frames with a bad IPv4, TCP or UDP checksum and fill in
+ *	     the IPv4 header checksum of sent frames
+ * tx_buffer - buffer lent to the network stack when offload is set
+ * tx_copy - buffer that other frames are copied to, as a DMA engine needs
+ * tx_copied - whether the last frame sent was copied to tx_copy
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
@@ -92,6 +98,10 @@ struct eth_sandbox_priv {
 	int recv_packets;
 	sandbox_eth_tx_hand_f *tx_handler;
 	void *priv;
+	bool offload;
+	uchar tx_buffer[PKTSIZE_ALIGN];
+	uchar tx_copy[PKTSIZE_ALIGN];
+	bool tx_copied;
 };
 
 /*
@@ -108,4 +118,14 @@ void sandbox_eth_set_tx_handler(int index, sandbox_eth_tx_hand_f *handler);
  */
 void sandbox_eth_set_priv(int index, void *priv);
 
+/*
+ * Enable or disable the mock checksum offload and transmit buffer
+ *
+ * Takes effect when the interface is next started.
+ *
+ * index - The alias index (also DM seq number)
+ * enable - true to advertise the offloads
+ */
+void sandbox_eth_set_offload(int index, bool enable);
+
 #endif /* __ETH_H */
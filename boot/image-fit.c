@@ -25,6 +25,7 @@
 #include <asm/io.h>
 #include <malloc.h>
 #include <asm/global_data.h>
+#include <watchdog.h>
 #ifdef CONFIG_DM_HASH
 #include <dm.h>
 #include <u-boot/hash.h>
@@ -1915,21 +1916,214 @@ int fit_conf_get_prop_node(const void *fit, int noffset,
 	return fit_conf_get_prop_node_index(fit, noffset, prop_name, 0);
 }
 
+static int fit_image_check_integrity(const void *fit, int noffset)
+{
+	puts("   Verifying Hash Integrity ... ");
+	if (!fit_image_verify(fit, noffset)) {
+		puts("Bad Data Hash\n");
+		return -EACCES;
+	}
+	puts("OK\n");
+
+	return 0;
+}
+
 static int fit_image_select(const void *fit, int rd_noffset, int verify)
 {
 	fit_image_print(fit, rd_noffset, "   ");
 
-	if (verify) {
-		puts("   Verifying Hash Integrity ... ");
-		if (!fit_image_verify(fit, rd_noffset)) {
-			puts("Bad Data Hash\n");
-			return -EACCES;
+	if (verify)
+		return fit_image_check_integrity(fit, rd_noffset);
+
+	return 0;
+}
+
+#ifndef USE_HOSTCC
+/* Most hash subnodes an image can have to be verified while it is loaded */
+#define FIT_LOAD_MAX_HASHES	4
+
+struct fit_load_hash {
+	struct hash_algo *algo;
+	void *ctx;
+	int noffset;
+};
+
+/**
+ * fit_image_can_verify_on_load() - check if an image can be verified as it
+ *				    is copied to its load address
+ *
+ * @fit:		pointer to the FIT format image header
+ * @image_noffset:	component image node offset
+ * Return: true if all hash subnodes use an algorithm which supports
+ * progressive hashing and the image has no signature or cipher subnodes
+ */
+static bool fit_image_can_verify_on_load(const void *fit, int image_noffset)
+{
+	struct hash_algo *algo;
+	int noffset, count = 0;
+	char *algo_name;
+
+	if (!CONFIG_IS_ENABLED(FIT_VERIFY_ON_LOAD) ||
+	    IS_ENABLED(CONFIG_DM_HASH) ||
+	    IS_ENABLED(CONFIG_FIT_IMAGE_POST_PROCESS))
+		return false;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (!strncmp(name, FIT_SIG_NODENAME, strlen(FIT_SIG_NODENAME)) ||
+		    !strcmp(name, FIT_CIPHER_NODENAME))
+			return false;
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (++count > FIT_LOAD_MAX_HASHES ||
+		    fit_image_hash_get_algo(fit, noffset, &algo_name) ||
+		    hash_progressive_lookup_algo(algo_name, &algo))
+			return false;
+	}
+
+	return true;
+}
+
+/**
+ * fit_image_load_verify() - copy an image to its load address and verify it
+ *
+ * The image is copied a chunk at a time and each chunk is hashed at its
+ * destination while it is still in the cache, so that the data is read from
+ * memory once rather than once for each hash and once more for the copy.
+ * The hashes are taken over the copy, which is the data that gets used.
+ *
+ * @fit:		pointer to the FIT format image header
+ * @image_noffset:	component image node offset
+ * @data:		image data in the FIT
+ * @load:		load address of the image
+ * @size:		size of the image data
+ * Return: 1 if all hashes are valid, 0 otherwise (or on error)
+ */
+static int fit_image_load_verify(const void *fit, int image_noffset,
+				 const void *data, void *load, size_t size)
+{
+	struct fit_load_hash hashes[FIT_LOAD_MAX_HASHES];
+	uint8_t value[FIT_MAX_HASH_LEN];
+	uint8_t *fit_value;
+	int fit_value_len, ignore, verify_all = 1;
+	int noffset = image_noffset, count = 0, i;
+	char *algo_name, *err_msg = NULL;
+	struct hash_algo *algo;
+	size_t done, chunk;
+
+	if (IS_ENABLED(CONFIG_FIT_SIGNATURE) &&
+	    strchr(fit_get_name(fit, image_noffset, NULL), '@')) {
+		err_msg = "Node name contains @";
+		goto error;
+	}
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+
+		fit_image_hash_get_algo(fit, noffset, &algo_name);
+		fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore) {
+			printf("%s-skipped ", algo_name);
+			continue;
 		}
-		puts("OK\n");
+
+		hash_progressive_lookup_algo(algo_name, &algo);
+		if (algo->hash_init(algo, &hashes[count].ctx)) {
+			err_msg = "Can't set up hash";
+			goto error;
+		}
+		hashes[count].algo = algo;
+		hashes[count++].noffset = noffset;
+	}
+
+	if (noffset == -FDT_ERR_TRUNCATED || noffset == -FDT_ERR_BADSTRUCTURE) {
+		err_msg = "Corrupted or truncated tree";
+		goto error;
+	}
+
+	for (done = 0; done < size; done += chunk) {
+		chunk = min_t(size_t, size - done, CHUNKSZ);
+		memcpy(load + done, data + done, chunk);
+		for (i = 0; i < count; i++) {
+			algo = hashes[i].algo;
+			if (algo->hash_update(algo, hashes[i].ctx, load + done,
+					      chunk, done + chunk == size)) {
+				/* The context is gone, don't finish it */
+				hashes[i].ctx = NULL;
+				noffset = hashes[i].noffset;
+				err_msg = "Can't calculate hash";
+				goto error;
+			}
+		}
+		WATCHDOG_RESET();
+	}
+
+	for (i = 0; i < count; i++) {
+		algo = hashes[i].algo;
+		noffset = hashes[i].noffset;
+		printf("%s", algo->name);
+		if (algo->hash_finish(algo, hashes[i].ctx, value,
+				      sizeof(value))) {
+			hashes[i].ctx = NULL;
+			err_msg = "Can't calculate hash";
+			goto error;
+		}
+		hashes[i].ctx = NULL;
+
+		if (fit_image_hash_get_value(fit, noffset, &fit_value,
+					     &fit_value_len)) {
+			err_msg = "Can't get hash value property";
+			goto error;
+		} else if (fit_value_len != algo->digest_size) {
+			err_msg = "Bad hash value len";
+			goto error;
+		} else if (memcmp(value, fit_value, fit_value_len)) {
+			err_msg = "Bad hash value";
+			goto error;
+		}
+		puts("+ ");
+	}
+
+	/* Images with required signatures need another pass, over the copy */
+	noffset = image_noffset;
+	if (FIT_IMAGE_ENABLE_VERIFY &&
+	    fit_image_verify_required_sigs(fit, image_noffset, load, size,
+					   gd_fdt_blob(), &verify_all)) {
+		err_msg = "Unable to verify required signature";
+		goto error;
 	}
 
+	return 1;
+
+error:
+	for (i = 0; i < count; i++) {
+		if (hashes[i].ctx)
+			hashes[i].algo->hash_finish(hashes[i].algo,
+						    hashes[i].ctx, value,
+						    sizeof(value));
+	}
+	printf(" error!\n%s for '%s' hash node in '%s' image node\n",
+	       err_msg, fit_get_name(fit, noffset, NULL),
+	       fit_get_name(fit, image_noffset, NULL));
+
 	return 0;
 }
+#else
+static bool fit_image_can_verify_on_load(const void *fit, int image_noffset)
+{
+	return false;
+}
+
+static int fit_image_load_verify(const void *fit, int image_noffset,
+				 const void *data, void *load, size_t size)
+{
+	return 0;
+}
+#endif /* !USE_HOSTCC */
 
 int fit_get_node_from_config(bootm_headers_t *images, const char *prop_name,
 			ulong addr)
@@ -2010,6 +2204,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	ulong load, load_end, data, len;
 	uint8_t os, comp;
 	const char *prop_name;
+	bool verify_on_load, decomp;
 	int ret;
 
 	fit = map_sysmem(addr, 0);
@@ -2084,7 +2279,14 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	/*
+	 * Hashes are checked while the data is copied to the load address,
+	 * if it is copied at all, see below
+	 */
+	verify_on_load = images->verify &&
+			 fit_image_can_verify_on_load(fit, noffset);
+	ret = fit_image_select(fit, noffset,
+			       images->verify && !verify_on_load);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
@@ -2204,11 +2406,23 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	comp = IH_COMP_NONE;
 	loadbuf = buf;
 	/* Kernel images get decompressed later in bootm_load_os(). */
-	if (!fit_image_get_comp(fit, noffset, &comp) &&
-	    comp != IH_COMP_NONE &&
-	    !(image_type == IH_TYPE_KERNEL ||
-	      image_type == IH_TYPE_KERNEL_NOLOAD ||
-	      image_type == IH_TYPE_RAMDISK)) {
+	decomp = !fit_image_get_comp(fit, noffset, &comp) &&
+		 comp != IH_COMP_NONE &&
+		 !(image_type == IH_TYPE_KERNEL ||
+		   image_type == IH_TYPE_KERNEL_NOLOAD ||
+		   image_type == IH_TYPE_RAMDISK);
+
+	/* Data which is not copied as it is must be verified in place */
+	if (verify_on_load && (decomp || load == data)) {
+		verify_on_load = false;
+		ret = fit_image_check_integrity(fit, noffset);
+		if (ret) {
+			bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
+			return ret;
+		}
+	}
+
+	if (decomp) {
 		ulong max_decomp_len = len * 20;
 		if (load == data) {
 			loadbuf = malloc(max_decomp_len);
@@ -2225,7 +2439,19 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		len = load_end - load;
 	} else if (load != data) {
 		loadbuf = map_sysmem(load, len);
-		memcpy(loadbuf, buf, len);
+		if (verify_on_load) {
+			puts("   Verifying Hash Integrity ... ");
+			if (!fit_image_load_verify(fit, noffset, buf, loadbuf,
+						   len)) {
+				puts("Bad Data Hash\n");
+				bootstage_error(bootstage_id +
+						BOOTSTAGE_SUB_HASH);
+				return -EACCES;
+			}
+			puts("OK\n");
+		} else {
+			memcpy(loadbuf, buf, len);
+		}
 	}
 
 	if (image_type == IH_TYPE_RAMDISK && comp != IH_COMP_NONE)
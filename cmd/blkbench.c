@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Block device benchmark
+ *
+ * Runs sequential and random access patterns at a range of transfer sizes
+ * and reports throughput, IOPS and latency percentiles for each.
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <console.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <part.h>
+#include <sort.h>
+#include <time.h>
+#include <linux/math64.h>
+
+/* Data moved by each test, within the limits on the number of transfers */
+#define BENCH_BYTES		(16 << 20)
+#define BENCH_MIN_OPS		4
+#define BENCH_MAX_OPS		4096
+/* Smallest transfer size, and the factor between the sizes tried */
+#define BENCH_MIN_SIZE		4096
+#define BENCH_SIZE_STEP		4
+/* Largest transfer size if none is given */
+#define BENCH_DEFAULT_SIZE	(1 << 20)
+
+struct bench_pattern {
+	const char *name;
+	bool random;
+	bool write;
+};
+
+static const struct bench_pattern bench_patterns[] = {
+	{ "seqread", false, false },
+	{ "randread", true, false },
+	{ "seqwrite", false, true },
+	{ "randwrite", true, true },
+};
+
+static u32 bench_seed;
+
+/* xorshift32, which is plenty to scatter the accesses */
+static u32 bench_rand(void)
+{
+	bench_seed ^= bench_seed << 13;
+	bench_seed ^= bench_seed >> 17;
+	bench_seed ^= bench_seed << 5;
+
+	return bench_seed;
+}
+
+static int bench_cmp(const void *a, const void *b)
+{
+	ulong x = *(const ulong *)a;
+	ulong y = *(const ulong *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int bench_run(struct blk_desc *desc, const struct bench_pattern *pat,
+		     void *buf, ulong size, ulong *lat)
+{
+	ulong blocks = size / desc->blksz;
+	ulong slots = min_t(lbaint_t, desc->lba, ULONG_MAX) / blocks;
+	ulong ops, i, n, start, time, total = 0;
+	u64 rate, iops;
+
+	if (!slots)
+		return 0;
+
+	ops = clamp(BENCH_BYTES / size, (ulong)BENCH_MIN_OPS,
+		    (ulong)BENCH_MAX_OPS);
+	for (i = 0; i < ops; i++) {
+		if (pat->random)
+			start = (bench_rand() % slots) * blocks;
+		else
+			start = (i % slots) * blocks;
+
+		/* Measure the device, not the block cache */
+		blkcache_invalidate(desc->if_type, desc->devnum);
+
+		time = timer_get_us();
+		if (pat->write)
+			n = blk_dwrite(desc, start, blocks, buf);
+		else
+			n = blk_dread(desc, start, blocks, buf);
+		lat[i] = timer_get_us() - time;
+		if (n != blocks) {
+			printf("%s of %lu blocks at %lu failed\n", pat->name,
+			       blocks, start);
+			return -EIO;
+		}
+		total += lat[i];
+
+		if (ctrlc())
+			return -EINTR;
+	}
+
+	qsort(lat, ops, sizeof(*lat), bench_cmp);
+	total = max(total, 1UL);
+	/* Bytes per microsecond are MB/s, keep one decimal */
+	rate = div_u64((u64)size * ops * 10, total);
+	iops = div_u64((u64)ops * 1000000, total);
+	printf("%-10s %7lu %7llu.%llu %8llu %8lu %8lu %8lu\n", pat->name,
+	       size >> 10, rate / 10, rate % 10, iops, lat[ops / 2],
+	       lat[ops * 99 / 100], lat[ops - 1]);
+
+	return 0;
+}
+
+int blk_bench(struct blk_desc *desc, ulong addr, ulong max_size, bool write)
+{
+	const struct bench_pattern *pat;
+	ulong size, min_size;
+	ulong *lat;
+	void *buf;
+	int ret = 0;
+
+	min_size = max_t(ulong, BENCH_MIN_SIZE, desc->blksz);
+	if (max_size < min_size || max_size % desc->blksz) {
+		printf("Transfer size must be a multiple of %lu, at least %lu\n",
+		       desc->blksz, min_size);
+		return -EINVAL;
+	}
+
+	lat = malloc(BENCH_MAX_OPS * sizeof(*lat));
+	if (!lat)
+		return -ENOMEM;
+	buf = map_sysmem(addr, max_size);
+	bench_seed = timer_get_us() | 1;
+
+	printf("%-10s %7s %9s %8s %8s %8s %8s\n", "pattern", "KiB", "MB/s",
+	       "IOPS", "p50(us)", "p99(us)", "max(us)");
+	for (pat = bench_patterns;
+	     !ret && pat < bench_patterns + ARRAY_SIZE(bench_patterns); pat++) {
+		if (pat->write != write)
+			continue;
+		for (size = min_size; !ret && size <= max_size;
+		     size *= BENCH_SIZE_STEP)
+			ret = bench_run(desc, pat, buf, size, lat);
+	}
+
+	unmap_sysmem(buf);
+	free(lat);
+
+	return ret;
+}
+
+int blk_bench_cmd(struct blk_desc *desc, int argc, char *const argv[])
+{
+	ulong addr, max_size = BENCH_DEFAULT_SIZE;
+	bool write = false;
+
+	if (argc < 1 || argc > 3)
+		return CMD_RET_USAGE;
+
+	addr = hextoul(argv[0], NULL);
+	if (argc > 1)
+		max_size = hextoul(argv[1], NULL);
+	if (argc > 2) {
+		if (!strcmp(argv[2], "write"))
+			write = true;
+		else if (strcmp(argv[2], "read"))
+			return CMD_RET_USAGE;
+	}
+
+	return blk_bench(desc, addr, max_size, write) ? CMD_RET_FAILURE :
+		CMD_RET_SUCCESS;
+}
+
+static int do_blkbench(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	struct blk_desc *desc;
+
+	if (argc < 4)
+		return CMD_RET_USAGE;
+
+	if (blk_get_device_by_str(argv[1], argv[2], &desc) < 0)
+		return CMD_RET_FAILURE;
+
+	return blk_bench_cmd(desc, argc - 3, argv + 3);
+}
+
+U_BOOT_CMD(
+	blkbench, 6, 0, do_blkbench,
+	"measure block device performance",
+	"<interface> <dev[:hwpart]> <addr> [<max_size> [read|write]]\n"
+	"    - run sequential and random reads (or writes) on the device, with\n"
+	"      transfers from 4 KiB up to <max_size> bytes (hex, default 1 MiB)\n"
+	"      through the buffer at <addr>\n"
+	"      WARNING: 'write' overwrites the device contents"
+);
@@ -18,11 +18,13 @@ static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 
 	printf("hits: %u\n"
 	       "misses: %u\n"
+	       "readaheads: %u\n"
 	       "entries: %u\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache entries: %u\n"
+	       "entries/set: %u\n",
+	       stats.hits, stats.misses, stats.readaheads, stats.entries,
+	       stats.max_blocks_per_entry, stats.max_entries, stats.ways);
 	return 0;
 }
 
@@ -84,5 +86,5 @@ U_BOOT_CMD(
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
 	"blkcache configure <blocks> <entries> "
-	"- set max blocks per entry and max cache entries\n"
+	"- set blocks per entry and cache entries per device\n"
 );
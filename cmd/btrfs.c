@@ -13,7 +13,7 @@ int do_btrsubvol(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 	if (argc != 3)
 		return CMD_RET_USAGE;
 
-	if (fs_set_blk_dev(argv[1], argv[2], FS_TYPE_BTRFS))
+	if (fs_set_blk_dev(argv[1], argv[2], FS_TYPE_BTRFS) || fs_mount())
 		return 1;
 
 	btrfs_list_subvols();
@@ -12,7 +12,49 @@
 #include <common.h>
 #include <command.h>
 #include <hash.h>
+#include <mapmem.h>
 #include <linux/ctype.h>
+#include <linux/math64.h>
+
+static int do_hash_bench(int argc, char *const argv[])
+{
+	static const char *const names[] = {
+		"crc16-ccitt", "crc32", "md5", "sha1", "sha256", "sha384",
+		"sha512",
+	};
+	u8 output[HASH_MAX_DIGEST_SIZE];
+	struct hash_algo *algo;
+	ulong addr, len, time;
+	void *buf;
+	u64 rate;
+	int i;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+
+	addr = hextoul(argv[1], NULL);
+	len = hextoul(argv[2], NULL);
+	buf = map_sysmem(addr, len);
+
+	printf("%-12s %10s %9s\n", "algorithm", "time(us)", "MB/s");
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		if (hash_lookup_algo(names[i], &algo))
+			continue;
+
+		time = timer_get_us();
+		algo->hash_func_ws(buf, len, output, algo->chunk_size);
+		time = max(timer_get_us() - time, 1UL);
+
+		/* Bytes per microsecond are MB/s, keep one decimal */
+		rate = div_u64((u64)len * 10, time);
+		printf("%-12s %10lu %7llu.%llu\n", algo->name, time, rate / 10,
+		       rate % 10);
+	}
+
+	unmap_sysmem(buf);
+
+	return CMD_RET_SUCCESS;
+}
 
 static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
 		   char *const argv[])
@@ -20,6 +62,9 @@ static int do_hash(struct cmd_tbl *cmdtp, int flag, int argc,
 	char *s;
 	int flags = HASH_FLAG_ENV;
 
+	if (argc > 1 && !strcmp(argv[1], "bench"))
+		return do_hash_bench(argc - 1, argv + 1);
+
 #ifdef CONFIG_HASH_VERIFY
 	if (argc < 4)
 		return CMD_RET_USAGE;
@@ -47,7 +92,9 @@ U_BOOT_CMD(
 	hash,	HARGS,	1,	do_hash,
 	"compute hash message digest",
 	"algorithm address count [[*]hash_dest]\n"
-		"    - compute message digest [save to env var / *address]"
+		"    - compute message digest [save to env var / *address]\n"
+	"hash bench address count\n"
+		"    - measure the speed of each algorithm on a memory area"
 #ifdef CONFIG_HASH_VERIFY
 	"\nhash -v algorithm address count [*]hash\n"
 		"    - verify message digest of memory area to immediate value, \n"
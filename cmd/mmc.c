@@ -362,6 +362,34 @@ static int do_mmc_read(struct cmd_tbl *cmdtp, int flag,
 	return (n == cnt) ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
 }
 
+#ifdef CONFIG_CMD_BLK_BENCH
+static int do_mmc_bench(struct cmd_tbl *cmdtp, int flag,
+			int argc, char *const argv[])
+{
+	__maybe_unused struct mmc_read_stats *stats;
+	struct mmc *mmc;
+	int ret;
+
+	mmc = init_mmc_device(curr_device, false);
+	if (!mmc)
+		return CMD_RET_FAILURE;
+
+#if CONFIG_IS_ENABLED(MMC_READ_STATS)
+	stats = &mmc->read_stats;
+	memset(stats, '\0', sizeof(*stats));
+#endif
+	ret = blk_bench_cmd(mmc_get_blk_desc(mmc), argc - 1, argv + 1);
+#if CONFIG_IS_ENABLED(MMC_READ_STATS)
+	if (stats->cmds)
+		printf("Reads: %lu commands, %lu blocks; setup %llu us, data %llu us, stop %llu us\n",
+		       stats->cmds, stats->blocks, stats->setup_us,
+		       stats->data_us, stats->stop_us);
+#endif
+
+	return ret;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(CMD_MMC_SWRITE)
 static lbaint_t mmc_sparse_write(struct sparse_storage *info, lbaint_t blk,
 				 lbaint_t blkcnt, const void *buffer)
@@ -1038,6 +1066,9 @@ static int do_mmc_boot_wp(struct cmd_tbl *cmdtp, int flag,
 static struct cmd_tbl cmd_mmc[] = {
 	U_BOOT_CMD_MKENT(info, 1, 0, do_mmcinfo, "", ""),
 	U_BOOT_CMD_MKENT(read, 4, 1, do_mmc_read, "", ""),
+#ifdef CONFIG_CMD_BLK_BENCH
+	U_BOOT_CMD_MKENT(bench, 4, 0, do_mmc_bench, "", ""),
+#endif
 	U_BOOT_CMD_MKENT(wp, 1, 0, do_mmc_boot_wp, "", ""),
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 	U_BOOT_CMD_MKENT(write, 4, 0, do_mmc_write, "", ""),
@@ -1101,6 +1132,9 @@ U_BOOT_CMD(
 	"info - display info of the current MMC device\n"
 	"mmc read addr blk# cnt\n"
 	"mmc write addr blk# cnt\n"
+#ifdef CONFIG_CMD_BLK_BENCH
+	"mmc bench addr [max_size [read|write]] - measure the current device's speed\n"
+#endif
 #if CONFIG_IS_ENABLED(CMD_MMC_SWRITE)
 	"mmc swrite addr blk#\n"
 #endif
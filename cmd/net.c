@@ -124,6 +124,25 @@ U_BOOT_CMD(
 );
 #endif
 
+#if defined(CONFIG_CMD_WGET)
+static int do_wget(struct cmd_tbl *cmdtp, int flag, int argc,
+		   char *const argv[])
+{
+	int ret;
+
+	bootstage_mark_name(BOOTSTAGE_KERNELREAD_START, "wget_start");
+	ret = netboot_common(WGET, cmdtp, argc, argv);
+	bootstage_mark_name(BOOTSTAGE_KERNELREAD_STOP, "wget_done");
+	return ret;
+}
+
+U_BOOT_CMD(
+	wget,	3,	1,	do_wget,
+	"boot image via network using HTTP protocol",
+	"[loadAddress] [[hostIPaddr:]path]"
+);
+#endif
+
 static void netboot_update_env(void)
 {
 	char tmp[22];
@@ -101,6 +101,7 @@ struct us_data {
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
 	unsigned short	max_xfer_blk;		/* maximum transfer blocks */
+	size_t		max_xfer_size;		/* host controller limit */
 };
 
 #if !CONFIG_IS_ENABLED(BLK)
@@ -958,19 +959,32 @@ static void usb_stor_set_max_xfer_blk(struct usb_device *udev,
 	 * Windows 7 limiting transfers to 128 sectors for both USB2 and USB3
 	 * and Apple Mac OS X 10.11 limiting transfers to 256 sectors for USB2
 	 * and 2048 for USB3 devices.
+	 *
+	 * USB3 devices are recent enough to cope with larger transfers, which
+	 * spread the cost of the command and status phases over more data.
 	 */
 	unsigned short blk = 240;
+	size_t size = SIZE_MAX;
 
-#if CONFIG_IS_ENABLED(DM_USB)
-	size_t size;
-	int ret;
+	if (udev->speed >= USB_SPEED_SUPER)
+		blk = CONFIG_USB_STORAGE_MAX_XFER_BLK_SS;
 
-	ret = usb_get_max_xfer_size(udev, (size_t *)&size);
-	if ((ret >= 0) && (size < blk * 512))
-		blk = size / 512;
+#if CONFIG_IS_ENABLED(DM_USB)
+	if (usb_get_max_xfer_size(udev, &size) < 0)
+		size = SIZE_MAX;
 #endif
 
 	us->max_xfer_blk = blk;
+	us->max_xfer_size = size;
+}
+
+/* Blocks per transfer, within the limits of the device and host */
+static unsigned short usb_stor_xfer_blk(struct us_data *us,
+					struct blk_desc *block_dev)
+{
+	size_t blk = us->max_xfer_size / block_dev->blksz;
+
+	return max_t(size_t, min_t(size_t, us->max_xfer_blk, blk), 1);
 }
 
 static int usb_inquiry(struct scsi_cmd *srb, struct us_data *ss)
@@ -1134,7 +1148,7 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned short smallblks, max_blk;
 	struct usb_device *udev;
 	struct us_data *ss;
 	int retry;
@@ -1159,6 +1173,7 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+	max_blk = usb_stor_xfer_blk(ss, block_dev);
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	usb_lock_async(udev, 1);
@@ -1174,12 +1189,12 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 		/* XXX need some comment here */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > ss->max_xfer_blk)
-			smallblks = ss->max_xfer_blk;
+		if (blks > max_blk)
+			smallblks = max_blk;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == ss->max_xfer_blk)
+		if (smallblks == max_blk)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1192,6 +1207,8 @@ retry_it:
 			blkcnt -= blks;
 			break;
 		}
+		/* Drop the settling delay again once a transfer succeeds */
+		ss->flags |= USB_READY;
 		start += smallblks;
 		blks -= smallblks;
 		buf_addr += srb->datalen;
@@ -1202,7 +1219,7 @@ retry_it:
 
 	usb_lock_async(udev, 0);
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= ss->max_xfer_blk)
+	if (blkcnt >= max_blk)
 		debug("\n");
 	return blkcnt;
 }
@@ -1217,7 +1234,7 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned short smallblks, max_blk;
 	struct usb_device *udev;
 	struct us_data *ss;
 	int retry;
@@ -1243,6 +1260,7 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	}
 #endif
 	ss = (struct us_data *)udev->privptr;
+	max_blk = usb_stor_xfer_blk(ss, block_dev);
 
 	usb_disable_asynch(1); /* asynch transfer not allowed */
 	usb_lock_async(udev, 1);
@@ -1261,12 +1279,12 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 		 */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > ss->max_xfer_blk)
-			smallblks = ss->max_xfer_blk;
+		if (blks > max_blk)
+			smallblks = max_blk;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == ss->max_xfer_blk)
+		if (smallblks == max_blk)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
@@ -1279,6 +1297,8 @@ retry_it:
 			blkcnt -= blks;
 			break;
 		}
+		/* Drop the settling delay again once a transfer succeeds */
+		ss->flags |= USB_READY;
 		start += smallblks;
 		blks -= smallblks;
 		buf_addr += srb->datalen;
@@ -1289,7 +1309,7 @@ retry_it:
 
 	usb_lock_async(udev, 0);
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= ss->max_xfer_blk)
+	if (blkcnt >= max_blk)
 		debug("\n");
 	return blkcnt;
 
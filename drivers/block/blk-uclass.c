@@ -441,7 +441,9 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
+	lbaint_t rastart, racnt;
 	ulong blks_read;
+	void *rabuf;
 
 	if (!ops->read)
 		return -ENOSYS;
@@ -449,6 +451,16 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
+
+	racnt = blkcache_readahead(block_dev, start, blkcnt, &rastart, &rabuf);
+	if (racnt && ops->read(dev, rastart, racnt, rabuf) == racnt) {
+		blkcache_fill(block_dev->if_type, block_dev->devnum,
+			      rastart, racnt, block_dev->blksz, rabuf);
+		memcpy(buffer, rabuf + (start - rastart) * block_dev->blksz,
+		       blkcnt * block_dev->blksz);
+		return blkcnt;
+	}
+
 	blks_read = ops->read(dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
@@ -483,6 +495,96 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 	return ops->erase(dev, start, blkcnt);
 }
 
+int blk_submit(struct blk_desc *block_dev, struct blk_req *req)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+
+	req->done = false;
+	req->result = 0;
+
+	/* Drivers without submit()/poll() complete the request right away */
+	if (!ops->submit || !ops->poll) {
+		if (req->write)
+			req->result = blk_dwrite(block_dev, req->start,
+						 req->blkcnt, req->buffer);
+		else
+			req->result = blk_dread(block_dev, req->start,
+						req->blkcnt, req->buffer);
+		req->done = true;
+		return 0;
+	}
+
+	if (req->write) {
+		blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	} else if (blkcache_read(block_dev->if_type, block_dev->devnum,
+				 req->start, req->blkcnt, block_dev->blksz,
+				 req->buffer)) {
+		req->result = req->blkcnt;
+		req->done = true;
+		return 0;
+	}
+
+	return ops->submit(dev, req);
+}
+
+int blk_poll(struct blk_desc *block_dev, struct blk_req *req)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+	int ret;
+
+	if (req->done)
+		return 0;
+
+	ret = ops->poll(dev, req);
+	if (ret)
+		return ret;
+	if (!req->done)
+		return -EBUSY;
+
+	/* Anything cached while the write was in flight may now be stale */
+	if (req->write)
+		blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	else if (req->result == req->blkcnt)
+		blkcache_fill(block_dev->if_type, block_dev->devnum,
+			      req->start, req->blkcnt, block_dev->blksz,
+			      req->buffer);
+
+	return 0;
+}
+
+long blk_wait(struct blk_desc *block_dev, struct blk_req *req)
+{
+	int ret;
+
+	do {
+		ret = blk_poll(block_dev, req);
+	} while (ret == -EBUSY);
+	if (ret)
+		return ret;
+
+	return req->result;
+}
+
+int blk_get_queue_depth(struct blk_desc *block_dev)
+{
+	struct udevice *dev = block_dev->bdev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+
+	if (!ops->submit || !ops->poll || !ops->get_queue_depth)
+		return 1;
+
+	return ops->get_queue_depth(dev);
+}
+
+bool blk_is_async(struct blk_desc *block_dev)
+{
+	const struct blk_ops *ops = blk_get_ops(block_dev->bdev);
+
+	return ops->submit && ops->poll;
+}
+
 int blk_get_from_parent(struct udevice *parent, struct udevice **devp)
 {
 	struct udevice *dev;
@@ -722,9 +824,20 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+
+	/* the device number may be reused by another device */
+	blkcache_invalidate(desc->if_type, desc->devnum);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
 	.per_device_plat_auto	= sizeof(struct blk_desc),
 };
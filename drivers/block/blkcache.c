@@ -6,32 +6,58 @@
  */
 #include <common.h>
 #include <blk.h>
+#include <env.h>
+#include <fs.h>
 #include <log.h>
 #include <malloc.h>
+#include <memalign.h>
 #include <part.h>
 #include <asm/global_data.h>
 #include <linux/ctype.h>
+#include <linux/kernel.h>
 #include <linux/list.h>
 
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
 DECLARE_GLOBAL_DATA_PTR;
 #endif
 
-struct block_cache_node {
+/*
+ * The cache is kept per block device. Each device cache is an array of
+ * 'sets' x 'ways' lines, each holding max_blocks_per_entry blocks aligned to
+ * a multiple of the line size. A line can only live in the set selected by
+ * hashing its tag, so a lookup only has to look at 'ways' lines. Within a set
+ * the least-recently used line is replaced.
+ */
+struct block_cache_line {
+	lbaint_t tag;		/* start block / blocks per line */
+	ulong age;		/* LRU stamp, 0 if the line is empty */
+};
+
+struct block_cache_dev {
 	struct list_head lh;
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
 	unsigned long blksz;
-	char *cache;
+	unsigned sets;
+	unsigned ways;
+	struct block_cache_line *lines;
+	char *data;
+	ulong tick;		/* incremented on each line access */
+	lbaint_t next;		/* block after the last device read, or NO_STREAM */
+	lbaint_t ra_blocks;	/* current read-ahead window */
+	char *rabuf;		/* read-ahead buffer */
+	lbaint_t rabuf_blocks;
 };
 
+/* No read from the device yet, so no read can continue a stream */
+#define NO_STREAM	((lbaint_t)-1)
+
 static LIST_HEAD(block_cache);
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_blocks_per_entry = CONFIG_BLOCK_CACHE_LINE_BLOCKS,
+	.max_entries = CONFIG_VAL(BLOCK_CACHE_ENTRIES),
+	.ways = CONFIG_BLOCK_CACHE_WAYS,
 };
 
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
@@ -46,131 +72,317 @@ int blkcache_init(void)
 }
 #endif
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
-{
-	struct block_cache_node *node;
-
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
-			return node;
+static void cache_free(struct block_cache_dev *dc)
+{
+	list_del(&dc->lh);
+	free(dc->rabuf);
+	free(dc->data);
+	free(dc->lines);
+	free(dc);
+}
+
+static unsigned cache_valid_lines(struct block_cache_dev *dc)
+{
+	unsigned i, count = 0;
+
+	for (i = 0; i < dc->sets * dc->ways; i++)
+		if (dc->lines[i].age)
+			count++;
+
+	return count;
+}
+
+/**
+ * cache_entries() - get the number of cache lines to use for a device
+ *
+ * This can be set for each device with an environment variable named after
+ * the device, e.g. 'blkcache_mmc0'. If this is not set, the default from
+ * 'blkcache configure' (or CONFIG_BLOCK_CACHE_ENTRIES) is used.
+ */
+static unsigned cache_entries(int iftype, int devnum)
+{
+	char name[32];
+
+	if (!CONFIG_IS_ENABLED(ENV_SUPPORT))
+		return _stats.max_entries;
+
+	snprintf(name, sizeof(name), "blkcache_%s%d",
+		 blk_get_if_type_name(iftype), devnum);
+
+	return env_get_ulong(name, 10, _stats.max_entries);
+}
+
+static struct block_cache_dev *cache_get(int iftype, int devnum,
+					 unsigned long blksz, bool create)
+{
+	struct block_cache_dev *dc;
+	unsigned entries;
+
+	list_for_each_entry(dc, &block_cache, lh) {
+		if (dc->iftype == iftype && dc->devnum == devnum) {
+			if (dc->blksz == blksz)
+				return dc;
+			_stats.entries -= cache_valid_lines(dc);
+			cache_free(dc);
+			break;
 		}
-	return 0;
+	}
+	if (!create)
+		return NULL;
+
+	dc = calloc(1, sizeof(*dc));
+	if (!dc)
+		return NULL;
+	dc->iftype = iftype;
+	dc->devnum = devnum;
+	dc->blksz = blksz;
+	dc->next = NO_STREAM;
+
+	entries = cache_entries(iftype, devnum);
+	dc->ways = min(entries, max(_stats.ways, 1U));
+	if (dc->ways && _stats.max_blocks_per_entry) {
+		dc->sets = entries / dc->ways;
+		dc->lines = calloc(dc->sets * dc->ways, sizeof(*dc->lines));
+		dc->data = malloc((size_t)dc->sets * dc->ways *
+				  _stats.max_blocks_per_entry * blksz);
+		if (!dc->lines || !dc->data) {
+			debug("%s: no memory for %u cache entries\n", __func__,
+			      entries);
+			free(dc->lines);
+			free(dc->data);
+			dc->lines = NULL;
+			dc->data = NULL;
+			dc->sets = 0;
+		}
+	}
+	if (!dc->sets)
+		dc->ways = 0;
+
+	list_add(&dc->lh, &block_cache);
+
+	return dc;
+}
+
+static unsigned cache_set(struct block_cache_dev *dc, lbaint_t tag)
+{
+	u64 hash = (u64)tag * 0x9e3779b97f4a7c15ULL;
+
+	return (unsigned)(hash >> 32) % dc->sets;
+}
+
+static struct block_cache_line *cache_find(struct block_cache_dev *dc,
+					   lbaint_t tag)
+{
+	struct block_cache_line *line;
+	unsigned i;
+
+	line = &dc->lines[cache_set(dc, tag) * dc->ways];
+	for (i = 0; i < dc->ways; i++, line++) {
+		if (line->age && line->tag == tag) {
+			line->age = ++dc->tick;
+			return line;
+		}
+	}
+
+	return NULL;
+}
+
+static struct block_cache_line *cache_alloc(struct block_cache_dev *dc,
+					    lbaint_t tag)
+{
+	struct block_cache_line *line, *lru;
+	unsigned i;
+
+	line = &dc->lines[cache_set(dc, tag) * dc->ways];
+	lru = line;
+	for (i = 0; i < dc->ways; i++, line++) {
+		if (line->age && line->tag == tag)
+			return line;
+		if (line->age < lru->age)
+			lru = line;
+	}
+
+	if (lru->age)
+		debug("drop: tag " LBAF "\n", lru->tag);
+	else
+		_stats.entries++;
+
+	return lru;
+}
+
+static char *cache_data(struct block_cache_dev *dc,
+			struct block_cache_line *line)
+{
+	return dc->data + (line - dc->lines) *
+		_stats.max_blocks_per_entry * dc->blksz;
+}
+
+/* reads bigger than this are passed straight through to the device */
+static lbaint_t cache_max_blocks(void)
+{
+	return max_t(lbaint_t, CONFIG_BLOCK_CACHE_READAHEAD,
+		     _stats.max_blocks_per_entry);
 }
 
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	const lbaint_t bpl = _stats.max_blocks_per_entry;
+	struct block_cache_dev *dc;
+	struct block_cache_line *line;
+	lbaint_t blk, end = start + blkcnt;
+	char *dst = buffer;
+
+	dc = cache_get(iftype, devnum, blksz, false);
+	if (!dc || !dc->sets || blkcnt > cache_max_blocks())
+		goto miss;
+
+	for (blk = start; blk < end; ) {
+		lbaint_t ofs = blk % bpl;
+		lbaint_t count = min(bpl - ofs, end - blk);
+
+		line = cache_find(dc, blk / bpl);
+		if (!line)
+			goto miss;
+		memcpy(dst, cache_data(dc, line) + ofs * blksz, count * blksz);
+		dst += count * blksz;
+		blk += count;
 	}
 
+	debug("hit: start " LBAF ", count " LBAFU "\n",
+	      start, blkcnt);
+	++_stats.hits;
+	return 1;
+
+miss:
 	debug("miss: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 	++_stats.misses;
 	return 0;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+lbaint_t blkcache_readahead(struct blk_desc *desc, lbaint_t start,
+			    lbaint_t blkcnt, lbaint_t *rastart, void **rabuf)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	const lbaint_t bpl = _stats.max_blocks_per_entry;
+	struct block_cache_dev *dc;
+	lbaint_t first, end;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+	if (blkcnt > cache_max_blocks())
+		return 0;
+	dc = cache_get(desc->if_type, desc->devnum, desc->blksz, true);
+	if (!dc || !dc->sets)
+		return 0;
 
-	if (_stats.max_entries == 0)
-		return;
+	/* read whole lines so that the data can be cached */
+	first = rounddown(start, bpl);
+	end = roundup(start + blkcnt, bpl);
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
+	/*
+	 * A miss which starts where the last device read ended is part of a
+	 * sequential stream. Fetch the blocks after it in the same read,
+	 * doubling the window each time up to CONFIG_BLOCK_CACHE_READAHEAD.
+	 */
+	if (start == dc->next && CONFIG_BLOCK_CACHE_READAHEAD) {
+		dc->ra_blocks = clamp_t(lbaint_t, dc->ra_blocks * 2, bpl,
+					roundup(CONFIG_BLOCK_CACHE_READAHEAD,
+						bpl));
+		end += dc->ra_blocks;
+		++_stats.readaheads;
 	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
+		dc->ra_blocks = 0;
 	}
+	if (desc->lba && end > desc->lba)
+		end = max(desc->lba, start + blkcnt);
+
+	if (first == start && end == start + blkcnt)
+		return 0;
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
+	if (end - first > dc->rabuf_blocks) {
+		free(dc->rabuf);
+		dc->rabuf = malloc_cache_aligned((end - first) * desc->blksz);
+		if (!dc->rabuf) {
+			dc->rabuf_blocks = 0;
+			return 0;
 		}
+		dc->rabuf_blocks = end - first;
 	}
+	*rastart = first;
+	*rabuf = dc->rabuf;
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+	debug("readahead: start " LBAF ", count " LBAFU "\n",
+	      first, end - first);
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	return end - first;
+}
+
+void blkcache_fill(int iftype, int devnum,
+		   lbaint_t start, lbaint_t blkcnt,
+		   unsigned long blksz, void const *buffer)
+{
+	const lbaint_t bpl = _stats.max_blocks_per_entry;
+	struct block_cache_dev *dc;
+	struct block_cache_line *line;
+	lbaint_t blk, end = start + blkcnt;
+	const char *src = buffer;
+
+	dc = cache_get(iftype, devnum, blksz, true);
+	if (!dc || !dc->sets)
+		return;
+
+	/* don't cache big stuff, only a read-ahead buffer may be larger */
+	if (blkcnt > cache_max_blocks() && buffer != dc->rabuf)
+		return;
+
+	/* the read succeeded, so a stream continues from its end */
+	dc->next = end;
+
+	/* only whole lines are cached */
+	blk = roundup(start, bpl);
+	src += (blk - start) * blksz;
+	for (; blk + bpl <= end; blk += bpl, src += bpl * blksz) {
+		line = cache_alloc(dc, blk / bpl);
+		debug("fill: start " LBAF ", count " LBAFU "\n",
+		      blk, bpl);
+		line->tag = blk / bpl;
+		line->age = ++dc->tick;
+		memcpy(cache_data(dc, line), src, bpl * blksz);
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
-
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+	struct block_cache_dev *dc;
+	unsigned i;
+
+	fs_cache_invalidate(iftype, devnum);
+
+	list_for_each_entry(dc, &block_cache, lh) {
+		if ((dc->iftype == iftype) &&
+		    (dc->devnum == devnum)) {
+			for (i = 0; i < dc->sets * dc->ways; i++) {
+				if (dc->lines[i].age)
+					--_stats.entries;
+				dc->lines[i].age = 0;
+			}
+			dc->next = NO_STREAM;
+			dc->ra_blocks = 0;
 		}
 	}
 }
 
 void blkcache_configure(unsigned blocks, unsigned entries)
 {
-	struct block_cache_node *node;
+	struct block_cache_dev *dc;
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
 	    (entries != _stats.max_entries)) {
 		/* invalidate cache */
 		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
+			dc = list_first_entry(&block_cache,
+					      struct block_cache_dev, lh);
+			cache_free(dc);
 		}
 		_stats.entries = 0;
 	}
@@ -180,6 +392,7 @@ void blkcache_configure(unsigned blocks, unsigned entries)
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -187,4 +400,5 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.readaheads = 0;
 }
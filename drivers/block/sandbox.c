@@ -243,9 +243,53 @@ int sandbox_host_unbind(struct udevice *dev)
 	return 0;
 }
 
+/*
+ * Requests are only carried out when polled, so that callers of blk_submit()
+ * see them in flight, as with a device doing DMA
+ */
+static int host_block_submit(struct udevice *dev, struct blk_req *req)
+{
+	struct host_block_dev *host_dev = dev_get_plat(dev);
+
+	if (host_dev->req)
+		return -EBUSY;
+	host_dev->req = req;
+
+	return 0;
+}
+
+static int host_block_poll(struct udevice *dev, struct blk_req *req)
+{
+	struct host_block_dev *host_dev = dev_get_plat(dev);
+
+	if (req->done)
+		return 0;
+	if (host_dev->req != req)
+		return -EINVAL;
+
+	if (req->write)
+		req->result = host_block_write(dev, req->start, req->blkcnt,
+					       req->buffer);
+	else
+		req->result = host_block_read(dev, req->start, req->blkcnt,
+					      req->buffer);
+	host_dev->req = NULL;
+	req->done = true;
+
+	return 0;
+}
+
+static int host_block_get_queue_depth(struct udevice *dev)
+{
+	return 1;
+}
+
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+	.submit	= host_block_submit,
+	.poll	= host_block_poll,
+	.get_queue_depth = host_block_get_queue_depth,
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
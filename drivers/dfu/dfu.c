@@ -17,11 +17,13 @@
 #include <hash.h>
 #include <linux/list.h>
 #include <linux/compiler.h>
+#include <linux/math64.h>
 
 LIST_HEAD(dfu_list);
 static int dfu_alt_num;
 static int alt_num_cnt;
 static struct hash_algo *dfu_hash_algo;
+static ulong dfu_start_time;
 #ifdef CONFIG_DFU_TIMEOUT
 static unsigned long dfu_timeout = 0;
 #endif
@@ -298,6 +300,7 @@ int dfu_transaction_initiate(struct dfu_entity *dfu, bool read)
 		return -ENOMEM;
 
 	dfu->i_buf_end = dfu->i_buf_start + dfu_get_buf_size();
+	dfu_start_time = get_timer(0);
 
 	if (read) {
 		ret = dfu->get_medium_size(dfu, &dfu->r_left);
@@ -314,6 +317,7 @@ int dfu_transaction_initiate(struct dfu_entity *dfu, bool read)
 
 int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 {
+	ulong time;
 	int ret = 0;
 
 	ret = dfu_write_buffer_drain(dfu);
@@ -323,6 +327,15 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 	if (dfu->flush_medium)
 		ret = dfu->flush_medium(dfu);
 
+	time = get_timer(dfu_start_time);
+	printf("\nDFU %s: ", dfu->name);
+	print_size(dfu->offset, " written");
+	if (time) {
+		printf(" in %lu ms, ", time);
+		print_size(div_u64(dfu->offset * 1000, time), "/s");
+	}
+	puts("\n");
+
 	if (dfu_hash_algo)
 		printf("\nDFU complete %s: 0x%08x\n", dfu_hash_algo->name,
 		       dfu->crc);
@@ -395,11 +395,23 @@ int mmc_send_tuning(struct mmc *mmc, u32 opcode, int *cmd_error)
 }
 #endif
 
+#if CONFIG_IS_ENABLED(MMC_READ_STATS)
+#define mmc_stats_time()	timer_get_us()
+#define mmc_stats_add(mmc, field, start) \
+	((mmc)->read_stats.field += timer_get_us() - (start))
+#define mmc_stats_count(mmc, field, n)	((mmc)->read_stats.field += (n))
+#else
+#define mmc_stats_time()	0
+#define mmc_stats_add(mmc, field, start)
+#define mmc_stats_count(mmc, field, n)
+#endif
+
 static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	__maybe_unused ulong time;
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -418,20 +430,26 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	data.blocksize = mmc->read_bl_len;
 	data.flags = MMC_DATA_READ;
 
+	time = mmc_stats_time();
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
+	mmc_stats_add(mmc, data_us, time);
+	mmc_stats_count(mmc, cmds, 1);
 
 	if (blkcnt > 1) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
+		time = mmc_stats_time();
 		if (mmc_send_cmd(mmc, &cmd, NULL)) {
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
 			pr_err("mmc fail to send stop cmd\n");
 #endif
 			return 0;
 		}
+		mmc_stats_add(mmc, stop_us, time);
 	}
+	mmc_stats_count(mmc, blocks, blkcnt);
 
 	return blkcnt;
 }
@@ -460,6 +478,7 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	int err;
 	lbaint_t cur, blocks_todo = blkcnt;
 	uint b_max;
+	__maybe_unused ulong time;
 
 	if (blkcnt == 0)
 		return 0;
@@ -468,6 +487,7 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	if (!mmc)
 		return 0;
 
+	time = mmc_stats_time();
 	if (CONFIG_IS_ENABLED(MMC_TINY))
 		err = mmc_switch_part(mmc, block_dev->hwpart);
 	else
@@ -490,6 +510,7 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	}
 
 	b_max = mmc_get_b_max(mmc, dst, blkcnt);
+	mmc_stats_add(mmc, setup_us, time);
 
 	do {
 		cur = (blocks_todo > b_max) ? b_max : blocks_todo;
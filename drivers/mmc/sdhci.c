@@ -71,6 +71,25 @@ static void sdhci_transfer_pio(struct sdhci_host *host, struct mmc_data *data)
 }
 
 #if (defined(CONFIG_MMC_SDHCI_SDMA) || CONFIG_IS_ENABLED(MMC_SDHCI_ADMA))
+/*
+ * Whether the transfer must go through align_buffer: always with
+ * CONFIG_FIXED_SDHCI_ALIGNED_BUFFER, and for addresses the DMA engine cannot
+ * use. ADMA2 needs 32-bit aligned data addresses.
+ */
+static bool sdhci_use_align_buffer(struct sdhci_host *host, void *buf)
+{
+	if (!host->align_buffer)
+		return false;
+	if (host->force_align_buffer)
+		return true;
+	if (host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR &&
+	    ((unsigned long)buf & 0x7) != 0x0)
+		return true;
+
+	return (host->flags & (USE_ADMA | USE_ADMA64)) &&
+	       ((unsigned long)buf & 0x3) != 0x0;
+}
+
 static void sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
 			      int *is_aligned, int trans_bytes)
 {
@@ -91,10 +110,7 @@ static void sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
 		ctrl |= SDHCI_CTRL_ADMA32;
 	sdhci_writeb(host, ctrl, SDHCI_HOST_CONTROL);
 
-	if (host->flags & USE_SDMA &&
-	    (host->force_align_buffer ||
-	     (host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR &&
-	      ((unsigned long)buf & 0x7) != 0x0))) {
+	if (sdhci_use_align_buffer(host, buf)) {
 		*is_aligned = 0;
 		if (data->flags != MMC_DATA_READ)
 			memcpy(host->align_buffer, buf, trans_bytes);
@@ -126,6 +142,22 @@ static void sdhci_prepare_dma(struct sdhci_host *host, struct mmc_data *data,
 			      int *is_aligned, int trans_bytes)
 {}
 #endif
+
+/*
+ * Unaligned buffers are moved by PIO when ADMA2 is used and there is no
+ * align_buffer to bounce them through.
+ */
+static bool sdhci_can_dma(struct sdhci_host *host, struct mmc_data *data)
+{
+	if (!(host->flags & USE_DMA))
+		return false;
+	if ((host->flags & (USE_ADMA | USE_ADMA64)) &&
+	    ((ulong)data->dest & 0x3) && !host->align_buffer)
+		return false;
+
+	return true;
+}
+
 static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data)
 {
 	dma_addr_t start_addr = host->start_addr;
@@ -178,8 +210,10 @@ static int sdhci_transfer_data(struct sdhci_host *host, struct mmc_data *data)
 	} while (!(stat & SDHCI_INT_DATA_END));
 
 #if (defined(CONFIG_MMC_SDHCI_SDMA) || CONFIG_IS_ENABLED(MMC_SDHCI_ADMA))
-	dma_unmap_single(host->start_addr, data->blocks * data->blocksize,
-			 mmc_get_dma_dir(data));
+	if (sdhci_can_dma(host, data))
+		dma_unmap_single(host->start_addr,
+				 data->blocks * data->blocksize,
+				 mmc_get_dma_dir(data));
 #endif
 
 	return 0;
@@ -281,7 +315,7 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 		if (data->flags == MMC_DATA_READ)
 			mode |= SDHCI_TRNS_READ;
 
-		if (host->flags & USE_DMA) {
+		if (sdhci_can_dma(host, data)) {
 			mode |= SDHCI_TRNS_DMA;
 			sdhci_prepare_dma(host, data, &is_aligned, trans_bytes);
 		}
@@ -329,8 +363,7 @@ static int sdhci_send_command(struct mmc *mmc, struct mmc_cmd *cmd,
 	stat = sdhci_readl(host, SDHCI_INT_STATUS);
 	sdhci_writel(host, SDHCI_INT_ALL_MASK, SDHCI_INT_STATUS);
 	if (!ret) {
-		if ((host->quirks & SDHCI_QUIRK_32BIT_DMA_ADDR) &&
-				!is_aligned && (data->flags == MMC_DATA_READ))
+		if (!is_aligned && (data->flags == MMC_DATA_READ))
 			memcpy(data->dest, host->align_buffer, trans_bytes);
 		return 0;
 	}
@@ -845,19 +878,24 @@ int sdhci_setup_cfg(struct mmc_config *cfg, struct sdhci_host *host,
 	}
 #endif
 #if CONFIG_IS_ENABLED(MMC_SDHCI_ADMA)
-	if (!(caps & SDHCI_CAN_DO_ADMA2)) {
-		printf("%s: Your controller doesn't support SDMA!!\n",
-		       __func__);
-		return -EINVAL;
-	}
-	host->adma_desc_table = sdhci_adma_init();
-	host->adma_addr = (dma_addr_t)host->adma_desc_table;
-
+	/*
+	 * A single ADMA2 descriptor chain covers the whole transfer, so prefer
+	 * it over SDMA, which stops at every DMA buffer boundary.
+	 */
+	if ((caps & SDHCI_CAN_DO_ADMA2) && !host->adma_desc_table)
+		host->adma_desc_table = sdhci_adma_init();
+	if (!(caps & SDHCI_CAN_DO_ADMA2) || !host->adma_desc_table) {
+		debug("%s: ADMA2 not available, falling back to %s\n",
+		      __func__, host->flags & USE_SDMA ? "SDMA" : "PIO");
+	} else {
+		host->adma_addr = (dma_addr_t)host->adma_desc_table;
+		host->flags &= ~USE_SDMA;
 #ifdef CONFIG_DMA_ADDR_T_64BIT
-	host->flags |= USE_ADMA64;
+		host->flags |= USE_ADMA64;
 #else
-	host->flags |= USE_ADMA;
+		host->flags |= USE_ADMA;
 #endif
+	}
 #endif
 	if (host->quirks & SDHCI_QUIRK_REG32_RW)
 		host->version =
@@ -12,6 +12,7 @@
 #include <errno.h>
 #include <log.h>
 #include <mmc.h>
+#include <sdhci.h>
 #include <asm/gpio.h>
 #include <asm/io.h>
 #include <asm/arch-tegra/tegra_mmc.h>
@@ -37,6 +38,7 @@ struct tegra_mmc_priv {
 	unsigned int version;	/* SDHCI spec. version */
 	unsigned int clock;	/* Current clock (MHz) */
 	int mmc_id;		/* peripheral id */
+	struct sdhci_adma_desc *adma_desc_table;	/* NULL to use SDMA */
 };
 
 static void tegra_mmc_set_power(struct tegra_mmc_priv *priv,
@@ -76,14 +78,14 @@ static void tegra_mmc_prepare_data(struct tegra_mmc_priv *priv,
 				   struct mmc_data *data,
 				   struct bounce_buffer *bbstate)
 {
+	dma_addr_t addr = (dma_addr_t)(unsigned long)bbstate->bounce_buffer;
+	unsigned long adma_addr;
 	unsigned char ctrl;
 
-
 	debug("buf: %p (%p), data->blocks: %u, data->blocksize: %u\n",
 		bbstate->bounce_buffer, bbstate->user_buffer, data->blocks,
 		data->blocksize);
 
-	writel((u32)(unsigned long)bbstate->bounce_buffer, &priv->reg->sysad);
 	/*
 	 * DMASEL[4:3]
 	 * 00 = Selects SDMA
@@ -93,7 +95,24 @@ static void tegra_mmc_prepare_data(struct tegra_mmc_priv *priv,
 	 */
 	ctrl = readb(&priv->reg->hostctl);
 	ctrl &= ~TEGRA_MMC_HOSTCTL_DMASEL_MASK;
-	ctrl |= TEGRA_MMC_HOSTCTL_DMASEL_SDMA;
+	if (IS_ENABLED(CONFIG_MMC_SDHCI_TEGRA_ADMA2) &&
+	    priv->adma_desc_table) {
+		/* One descriptor chain covers the whole transfer */
+		sdhci_prepare_adma_table(priv->adma_desc_table, data, addr);
+
+		adma_addr = (unsigned long)priv->adma_desc_table;
+		writel(lower_32_bits(adma_addr), &priv->reg->admaaddr);
+		if (IS_ENABLED(CONFIG_DMA_ADDR_T_64BIT)) {
+			writel(upper_32_bits(adma_addr),
+			       &priv->reg->admaaddr_hi);
+			ctrl |= TEGRA_MMC_HOSTCTL_DMASEL_ADMA2_64BIT;
+		} else {
+			ctrl |= TEGRA_MMC_HOSTCTL_DMASEL_ADMA2_32BIT;
+		}
+	} else {
+		writel((u32)addr, &priv->reg->sysad);
+		ctrl |= TEGRA_MMC_HOSTCTL_DMASEL_SDMA;
+	}
 	writeb(ctrl, &priv->reg->hostctl);
 
 	/* We do not handle DMA boundaries, so set it to max (512 KiB) */
@@ -297,16 +316,21 @@ static int tegra_mmc_send_cmd_bounced(struct udevice *dev, struct mmc_cmd *cmd,
 						__func__, mask);
 				return -1;
 			} else if (mask & TEGRA_MMC_NORINTSTS_DMA_INTERRUPT) {
-				/*
-				 * DMA Interrupt, restart the transfer where
-				 * it was interrupted.
-				 */
-				unsigned int address = readl(&priv->reg->sysad);
-
 				debug("DMA end\n");
 				writel(TEGRA_MMC_NORINTSTS_DMA_INTERRUPT,
 				       &priv->reg->norintsts);
-				writel(address, &priv->reg->sysad);
+				/*
+				 * SDMA stopped at a boundary, restart the
+				 * transfer where it was interrupted. ADMA2
+				 * only stops here for descriptors asking for
+				 * an interrupt, which we never set.
+				 */
+				if (!priv->adma_desc_table) {
+					unsigned int address =
+						readl(&priv->reg->sysad);
+
+					writel(address, &priv->reg->sysad);
+				}
 			} else if (mask & TEGRA_MMC_NORINTSTS_XFER_COMPLETE) {
 				/* Transfer Complete */
 				debug("r/w is done\n");
@@ -684,6 +708,7 @@ static int tegra_mmc_probe(struct udevice *dev)
 	struct tegra_mmc_priv *priv = dev_get_priv(dev);
 	struct mmc_config *cfg = &plat->cfg;
 	int bus_width, ret;
+	u32 caps;
 
 	cfg->name = dev->name;
 
@@ -742,6 +767,21 @@ static int tegra_mmc_probe(struct udevice *dev)
 	if (dm_gpio_is_valid(&priv->pwr_gpio))
 		dm_gpio_set_value(&priv->pwr_gpio, 1);
 
+	if (IS_ENABLED(CONFIG_MMC_SDHCI_TEGRA_ADMA2)) {
+		caps = readl(&priv->reg->capareg);
+		/*
+		 * The descriptors hold 64-bit addresses on 64-bit builds, so
+		 * the controller must support 64-bit ADMA2 there as well.
+		 */
+		if ((caps & TEGRA_MMC_CAPAREG_ADMA2) &&
+		    (!IS_ENABLED(CONFIG_DMA_ADDR_T_64BIT) ||
+		     (caps & TEGRA_MMC_CAPAREG_64BIT))) {
+			priv->adma_desc_table = sdhci_adma_init();
+			if (!priv->adma_desc_table)
+				debug("Could not allocate ADMA tables, falling back to SDMA\n");
+		}
+	}
+
 	upriv->mmc = &plat->mmc;
 
 	return tegra_mmc_init(dev);
@@ -83,6 +83,7 @@ struct eqos_mac_regs {
 	uint32_t address0_low;				/* 0x304 */
 };
 
+#define EQOS_MAC_CONFIGURATION_IPC			BIT(27)
 #define EQOS_MAC_CONFIGURATION_GPSLCE			BIT(23)
 #define EQOS_MAC_CONFIGURATION_CST			BIT(21)
 #define EQOS_MAC_CONFIGURATION_ACS			BIT(20)
@@ -114,6 +115,8 @@ struct eqos_mac_regs {
 #define EQOS_MAC_RXQ_CTRL2_PSRQ0_SHIFT			0
 #define EQOS_MAC_RXQ_CTRL2_PSRQ0_MASK			0xff
 
+#define EQOS_MAC_HW_FEATURE0_RXCOESEL			BIT(16)
+#define EQOS_MAC_HW_FEATURE0_TXCOESEL			BIT(14)
 #define EQOS_MAC_HW_FEATURE0_MMCSEL_SHIFT		8
 #define EQOS_MAC_HW_FEATURE0_HDSEL_SHIFT		2
 #define EQOS_MAC_HW_FEATURE0_GMIISEL_SHIFT		1
@@ -241,7 +244,7 @@ struct eqos_tegra186_regs {
 
 /* Descriptors */
 #define EQOS_DESCRIPTORS_TX	4
-#define EQOS_DESCRIPTORS_RX	4
+#define EQOS_DESCRIPTORS_RX	PKTBUFSRX
 #define EQOS_DESCRIPTORS_NUM	(EQOS_DESCRIPTORS_TX + EQOS_DESCRIPTORS_RX)
 #define EQOS_BUFFER_ALIGN	ARCH_DMA_MINALIGN
 #define EQOS_MAX_PACKET_SIZE	ALIGN(1568, ARCH_DMA_MINALIGN)
@@ -257,7 +260,13 @@ struct eqos_desc {
 #define EQOS_DESC3_OWN		BIT(31)
 #define EQOS_DESC3_FD		BIT(29)
 #define EQOS_DESC3_LD		BIT(28)
+#define EQOS_DESC3_RS1V	BIT(26)
 #define EQOS_DESC3_BUF1V	BIT(24)
+/* Insert the IPv4 header and TCP/UDP checksums (transmit) */
+#define EQOS_DESC3_CIC_FULL	(3 << 16)
+/* Checksum errors found on receive, valid with EQOS_DESC3_RS1V */
+#define EQOS_DESC1_IPCE		BIT(7)
+#define EQOS_DESC1_IPHE		BIT(3)
 
 #define EQOS_AXI_WIDTH_32	4
 #define EQOS_AXI_WIDTH_64	8
@@ -314,11 +323,13 @@ struct eqos_priv {
 	int tx_desc_idx, rx_desc_idx;
 	unsigned int desc_size;
 	void *tx_dma_buf;
+	void *tx_copy_buf;
 	void *rx_dma_buf;
 	void *rx_pkt;
 	bool started;
 	bool reg_access_ok;
 	bool clk_ck_enabled;
+	int features;
 };
 
 /*
@@ -1327,6 +1338,18 @@ static int eqos_start(struct udevice *dev)
 	writel(EQOS_DESCRIPTORS_RX - 1,
 	       &eqos->dma_regs->ch0_rxdesc_ring_length);
 
+	/* Use the checksum engines, if the MAC has them */
+	val = readl(&eqos->mac_regs->hw_feature0);
+	eqos->features = 0;
+	if (val & EQOS_MAC_HW_FEATURE0_RXCOESEL) {
+		setbits_le32(&eqos->mac_regs->configuration,
+			     EQOS_MAC_CONFIGURATION_IPC);
+		eqos->features |= ETH_FEATURE_RX_CSUM;
+	}
+	if (val & EQOS_MAC_HW_FEATURE0_TXCOESEL)
+		eqos->features |= ETH_FEATURE_TX_CSUM_IP |
+				  ETH_FEATURE_TX_CSUM_L4;
+
 	/* Enable everything */
 	setbits_le32(&eqos->dma_regs->ch0_tx_control,
 		     EQOS_DMA_CH0_TX_CONTROL_ST);
@@ -1387,7 +1410,8 @@ static void eqos_stop(struct udevice *dev)
 
 	/* Turn off MAC TX and RX */
 	clrbits_le32(&eqos->mac_regs->configuration,
-		     EQOS_MAC_CONFIGURATION_TE | EQOS_MAC_CONFIGURATION_RE);
+		     EQOS_MAC_CONFIGURATION_TE | EQOS_MAC_CONFIGURATION_RE |
+		     EQOS_MAC_CONFIGURATION_IPC);
 
 	/* Wait for all RX packets to drain out of MTL */
 	for (i = 0; i < 1000000; i++) {
@@ -1416,19 +1440,28 @@ static int eqos_send(struct udevice *dev, void *packet, int length)
 {
 	struct eqos_priv *eqos = dev_get_priv(dev);
 	struct eqos_desc *tx_desc;
+	void *buf = packet;
 	int i;
 
 	debug("%s(dev=%p, packet=%p, length=%d):\n", __func__, dev, packet,
 	      length);
 
-	memcpy(eqos->tx_dma_buf, packet, length);
-	eqos->config->ops->eqos_flush_buffer(eqos->tx_dma_buf, length);
+	/*
+	 * Frames built in the buffer lent to the stack are sent in place.
+	 * Others, such as ARP requests, are copied to a buffer of their own,
+	 * since the lent one may hold a frame waiting for an ARP reply.
+	 */
+	if (packet != eqos->tx_dma_buf) {
+		buf = eqos->tx_copy_buf;
+		memcpy(buf, packet, length);
+	}
+	eqos->config->ops->eqos_flush_buffer(buf, length);
 
 	tx_desc = eqos_get_desc(eqos, eqos->tx_desc_idx, false);
 	eqos->tx_desc_idx++;
 	eqos->tx_desc_idx %= EQOS_DESCRIPTORS_TX;
 
-	tx_desc->des0 = (ulong)eqos->tx_dma_buf;
+	tx_desc->des0 = (ulong)buf;
 	tx_desc->des1 = 0;
 	tx_desc->des2 = length;
 	/*
@@ -1437,6 +1470,8 @@ static int eqos_send(struct udevice *dev, void *packet, int length)
 	 */
 	mb();
 	tx_desc->des3 = EQOS_DESC3_OWN | EQOS_DESC3_FD | EQOS_DESC3_LD | length;
+	if (eqos->features & ETH_FEATURE_TX_CSUM_L4)
+		tx_desc->des3 |= EQOS_DESC3_CIC_FULL;
 	eqos->config->ops->eqos_flush_desc(tx_desc);
 
 	writel((ulong)eqos_get_desc(eqos, eqos->tx_desc_idx, false),
@@ -1454,6 +1489,19 @@ static int eqos_send(struct udevice *dev, void *packet, int length)
 	return -ETIMEDOUT;
 }
 
+/* Length of a received frame, 0 to drop it if its checksums are bad */
+static int eqos_rx_length(struct eqos_priv *eqos, struct eqos_desc *rx_desc)
+{
+	if ((eqos->features & ETH_FEATURE_RX_CSUM) &&
+	    (rx_desc->des3 & EQOS_DESC3_RS1V) &&
+	    (rx_desc->des1 & (EQOS_DESC1_IPCE | EQOS_DESC1_IPHE))) {
+		debug("%s: bad checksum, dropped\n", __func__);
+		return 0;
+	}
+
+	return rx_desc->des3 & 0x7fff;
+}
+
 static int eqos_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eqos_priv *eqos = dev_get_priv(dev);
@@ -1471,7 +1519,7 @@ static int eqos_recv(struct udevice *dev, int flags, uchar **packetp)
 
 	*packetp = eqos->rx_dma_buf +
 		(eqos->rx_desc_idx * EQOS_MAX_PACKET_SIZE);
-	length = rx_desc->des3 & 0x7fff;
+	length = eqos_rx_length(eqos, rx_desc);
 	debug("%s: *packetp=%p, length=%d\n", __func__, *packetp, length);
 
 	eqos->config->ops->eqos_inval_buffer(*packetp, length);
@@ -1479,6 +1527,49 @@ static int eqos_recv(struct udevice *dev, int flags, uchar **packetp)
 	return length;
 }
 
+static int eqos_recv_batch(struct udevice *dev, int flags, uchar **packets,
+			   int *lengths, int max)
+{
+	struct eqos_priv *eqos = dev_get_priv(dev);
+	struct eqos_desc *rx_desc;
+	int idx;
+	int n;
+
+	debug("%s(dev=%p, flags=%x, max=%d):\n", __func__, dev, flags, max);
+
+	/* Descriptors are handed back to the DMA in order by free_pkt() */
+	for (n = 0; n < min(max, EQOS_DESCRIPTORS_RX); n++) {
+		idx = (eqos->rx_desc_idx + n) % EQOS_DESCRIPTORS_RX;
+		rx_desc = eqos_get_desc(eqos, idx, true);
+		eqos->config->ops->eqos_inval_desc(rx_desc);
+		if (rx_desc->des3 & EQOS_DESC3_OWN)
+			break;
+
+		packets[n] = eqos->rx_dma_buf + (idx * EQOS_MAX_PACKET_SIZE);
+		lengths[n] = eqos_rx_length(eqos, rx_desc);
+		eqos->config->ops->eqos_inval_buffer(packets[n], lengths[n]);
+	}
+	debug("%s: %d packets\n", __func__, n);
+
+	return n;
+}
+
+static int eqos_get_features(struct udevice *dev)
+{
+	struct eqos_priv *eqos = dev_get_priv(dev);
+
+	return eqos->features;
+}
+
+static int eqos_get_tx_buffer(struct udevice *dev, uchar **bufp)
+{
+	struct eqos_priv *eqos = dev_get_priv(dev);
+
+	*bufp = eqos->tx_dma_buf;
+
+	return 0;
+}
+
 static int eqos_free_pkt(struct udevice *dev, uchar *packet, int length)
 {
 	struct eqos_priv *eqos = dev_get_priv(dev);
@@ -1544,11 +1635,19 @@ static int eqos_probe_resources_core(struct udevice *dev)
 	}
 	debug("%s: tx_dma_buf=%p\n", __func__, eqos->tx_dma_buf);
 
+	eqos->tx_copy_buf = memalign(EQOS_BUFFER_ALIGN, EQOS_MAX_PACKET_SIZE);
+	if (!eqos->tx_copy_buf) {
+		debug("%s: memalign(tx_copy_buf) failed\n", __func__);
+		ret = -ENOMEM;
+		goto err_free_tx_dma_buf;
+	}
+	debug("%s: tx_copy_buf=%p\n", __func__, eqos->tx_copy_buf);
+
 	eqos->rx_dma_buf = memalign(EQOS_BUFFER_ALIGN, EQOS_RX_BUFFER_SIZE);
 	if (!eqos->rx_dma_buf) {
 		debug("%s: memalign(rx_dma_buf) failed\n", __func__);
 		ret = -ENOMEM;
-		goto err_free_tx_dma_buf;
+		goto err_free_tx_copy_buf;
 	}
 	debug("%s: rx_dma_buf=%p\n", __func__, eqos->rx_dma_buf);
 
@@ -1568,6 +1667,8 @@ static int eqos_probe_resources_core(struct udevice *dev)
 
 err_free_rx_dma_buf:
 	free(eqos->rx_dma_buf);
+err_free_tx_copy_buf:
+	free(eqos->tx_copy_buf);
 err_free_tx_dma_buf:
 	free(eqos->tx_dma_buf);
 err_free_descs:
@@ -1586,6 +1687,7 @@ static int eqos_remove_resources_core(struct udevice *dev)
 
 	free(eqos->rx_pkt);
 	free(eqos->rx_dma_buf);
+	free(eqos->tx_copy_buf);
 	free(eqos->tx_dma_buf);
 	eqos_free_descs(eqos->descs);
 
@@ -1928,9 +2030,12 @@ static const struct eth_ops eqos_ops = {
 	.stop = eqos_stop,
 	.send = eqos_send,
 	.recv = eqos_recv,
+	.recv_batch = eqos_recv_batch,
 	.free_pkt = eqos_free_pkt,
 	.write_hwaddr = eqos_write_hwaddr,
 	.read_rom_hwaddr	= eqos_read_rom_hwaddr,
+	.get_features = eqos_get_features,
+	.get_tx_buffer = eqos_get_tx_buffer,
 };
 
 static struct eqos_ops eqos_tegra186_ops = {
@@ -320,6 +320,26 @@ void sandbox_eth_set_priv(int index, void *priv)
 	dev_priv->priv = priv;
 }
 
+/*
+ * Enable or disable the mock checksum offload and transmit buffer
+ *
+ * index - The alias index (also DM seq number)
+ * enable - true to advertise the offloads
+ */
+void sandbox_eth_set_offload(int index, bool enable)
+{
+	struct udevice *dev;
+	struct eth_sandbox_priv *priv;
+	int ret;
+
+	ret = uclass_get_device(UCLASS_ETH, index, &dev);
+	if (ret)
+		return;
+
+	priv = dev_get_priv(dev);
+	priv->offload = enable;
+}
+
 static int sb_eth_start(struct udevice *dev)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -344,9 +364,69 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 	if (priv->disabled)
 		return 0;
 
+	/*
+	 * Like a driver which lends its DMA buffer, send frames built
+	 * elsewhere (ARP requests, in-place replies) from a copy. The lent
+	 * buffer may hold a frame which is waiting for an ARP reply.
+	 */
+	priv->tx_copied = priv->offload && packet != priv->tx_buffer;
+	if (priv->tx_copied) {
+		memcpy(priv->tx_copy, packet, length);
+		packet = priv->tx_copy;
+	}
+
+	/* Fill in the IPv4 header checksum, as the hardware would */
+	if (priv->offload && length >= ETHER_HDR_SIZE + IP_HDR_SIZE) {
+		struct ethernet_hdr *eth = packet;
+		struct ip_hdr *ip = packet + ETHER_HDR_SIZE;
+
+		if (ntohs(eth->et_protlen) == PROT_IP) {
+			ip->ip_sum = 0;
+			ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
+		}
+	}
+
 	return priv->tx_handler(dev, packet, length);
 }
 
+/*
+ * Check a received frame as a MAC with ETH_FEATURE_RX_CSUM would: the IPv4
+ * header checksum and, for TCP and UDP, the checksum over the pseudo header
+ * and the segment. A UDP checksum of zero means that none was sent. IPv4
+ * options and fragments are not handled, since the stack drops them anyway.
+ */
+static bool sb_eth_rx_csum_ok(uchar *packet, int len)
+{
+	struct ethernet_hdr *eth = (void *)packet;
+	struct ip_udp_hdr *ip = (void *)packet + ETHER_HDR_SIZE;
+	u16 pseudo[6];
+	uint sum;
+	int l4_len;
+
+	if (len < ETHER_HDR_SIZE + IP_HDR_SIZE ||
+	    ntohs(eth->et_protlen) != PROT_IP)
+		return true;
+	if (!ip_checksum_ok(ip, IP_HDR_SIZE))
+		return false;
+	if (ip->ip_p != IPPROTO_TCP && ip->ip_p != IPPROTO_UDP)
+		return true;
+
+	l4_len = ntohs(ip->ip_len) - IP_HDR_SIZE;
+	if (l4_len < 0 || ETHER_HDR_SIZE + IP_HDR_SIZE + l4_len > len)
+		return false;
+	if (ip->ip_p == IPPROTO_UDP && !ip->udp_xsum)
+		return true;
+
+	memcpy(pseudo, &ip->ip_src, 2 * sizeof(struct in_addr));
+	pseudo[4] = htons(ip->ip_p);
+	pseudo[5] = htons(l4_len);
+	sum = compute_ip_checksum(pseudo, sizeof(pseudo));
+	sum = add_ip_checksums(sizeof(pseudo), sum,
+			       compute_ip_checksum(&ip->udp_src, l4_len));
+
+	return !(sum & 0xfffe);
+}
+
 static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -359,6 +439,12 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 	if (priv->recv_packets) {
 		int lcl_recv_packet_length = priv->recv_packet_length[0];
 
+		/* Hand back a frame with a bad checksum as an empty one to drop */
+		if (priv->offload &&
+		    !sb_eth_rx_csum_ok(priv->recv_packet_buffer[0],
+				       lcl_recv_packet_length))
+			lcl_recv_packet_length = 0;
+
 		debug("eth_sandbox: received packet[%d], %d waiting\n",
 		      lcl_recv_packet_length, priv->recv_packets - 1);
 		*packetp = priv->recv_packet_buffer[0];
@@ -387,6 +473,28 @@ static int sb_eth_free_pkt(struct udevice *dev, uchar *packet, int length)
 	return 0;
 }
 
+static int sb_eth_get_features(struct udevice *dev)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	/*
+	 * Received frames are checked in full by sb_eth_rx_csum_ok(), but only
+	 * the IPv4 header checksum is filled in on transmit
+	 */
+	return priv->offload ? ETH_FEATURE_RX_CSUM | ETH_FEATURE_TX_CSUM_IP : 0;
+}
+
+static int sb_eth_get_tx_buffer(struct udevice *dev, uchar **bufp)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+
+	if (!priv->offload)
+		return -ENOSYS;
+	*bufp = priv->tx_buffer;
+
+	return 0;
+}
+
 static void sb_eth_stop(struct udevice *dev)
 {
 	debug("eth_sandbox: Stop\n");
@@ -408,6 +516,8 @@ static const struct eth_ops sb_eth_ops = {
 	.free_pkt		= sb_eth_free_pkt,
 	.stop			= sb_eth_stop,
 	.write_hwaddr		= sb_eth_write_hwaddr,
+	.get_features		= sb_eth_get_features,
+	.get_tx_buffer		= sb_eth_get_tx_buffer,
 };
 
 static int sb_eth_remove(struct udevice *dev)
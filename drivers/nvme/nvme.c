@@ -18,7 +18,7 @@
 #include <linux/compat.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		32
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
@@ -26,7 +26,7 @@
 				      ARCH_DMA_MINALIGN)
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
+#define NVME_MAX_TRANSFER_SHIFT	20
 
 enum nvme_queue_id {
 	NVME_ADMIN_Q,
@@ -73,16 +73,15 @@ static int nvme_wait_ready(struct nvme_dev *dev, bool enabled)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
+static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp_list, u64 *prp2,
 			   int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
+	u64 *prp = prp_list;
 	int length = total_len;
 	int i, nprps;
 	u32 prps_per_page = page_size >> 3;
-	u32 num_pages;
 
 	length -= (page_size - offset);
 
@@ -100,39 +99,24 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 	}
 
 	nprps = DIV_ROUND_UP(length, page_size);
-	num_pages = DIV_ROUND_UP(nprps, prps_per_page);
+	if (nprps > dev->max_prps)
+		return -EINVAL;
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		/*
-		 * Always increase in increments of pages.  It doesn't waste
-		 * much memory and reduces the number of allocations.
-		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
-			return -ENOMEM;
-		}
-		dev->prp_entry_num = prps_per_page * num_pages;
-	}
-
-	prp_pool = dev->prp_pool;
 	i = 0;
 	while (nprps) {
-		if (i == ((page_size >> 3) - 1)) {
-			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
-					page_size);
+		if (i == prps_per_page - 1) {
+			*(prp + i) = cpu_to_le64((ulong)(prp + prps_per_page));
 			i = 0;
-			prp_pool += page_size;
+			prp += prps_per_page;
 		}
-		*(prp_pool + i++) = cpu_to_le64(dma_addr);
+		*(prp + i++) = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
 		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)prp_list;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
-			   dev->prp_entry_num * sizeof(u64));
+	flush_dcache_range((ulong)prp_list,
+			   ALIGN((ulong)(prp + i), ARCH_DMA_MINALIGN));
 
 	return 0;
 }
@@ -149,24 +133,26 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 	/*
 	 * Single CQ entries are always smaller than a cache line, so we
 	 * can't invalidate them individually. However CQ entries are
-	 * read only by the CPU, so it's safe to always invalidate all of them,
-	 * as the cache line should never become dirty.
+	 * read only by the CPU, so it's safe to invalidate the whole line
+	 * holding the entry, as the cache line should never become dirty.
 	 */
-	ulong start = (ulong)&nvmeq->cqes[0];
-	ulong stop = start + NVME_CQ_ALLOCATION;
+	ulong start = (ulong)&nvmeq->cqes[index] & ~(ARCH_DMA_MINALIGN - 1);
 
-	invalidate_dcache_range(start, stop);
+	invalidate_dcache_range(start, start + ARCH_DMA_MINALIGN);
 
 	return readw(&(nvmeq->cqes[index].status));
 }
 
 /**
- * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ * nvme_queue_cmd() - copy a command into a queue without ringing the doorbell
+ *
+ * The controller does not see the command until nvme_ring_sq() is called,
+ * so several commands can be handed over with a single doorbell write.
  *
  * @nvmeq:	The queue to use
  * @cmd:	The command to send
  */
-static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+static void nvme_queue_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 {
 	u16 tail = nvmeq->sq_tail;
 
@@ -176,52 +162,56 @@ static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 
 	if (++tail == nvmeq->q_depth)
 		tail = 0;
-	writel(tail, nvmeq->q_db);
 	nvmeq->sq_tail = tail;
 }
 
-static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
-				struct nvme_command *cmd,
-				u32 *result, unsigned timeout)
+static void nvme_ring_sq(struct nvme_queue *nvmeq)
+{
+	writel(nvmeq->sq_tail, nvmeq->q_db);
+}
+
+/**
+ * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send
+ */
+static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	nvme_queue_cmd(nvmeq, cmd);
+	nvme_ring_sq(nvmeq);
+}
+
+/**
+ * nvme_reap_cmd() - consume the next completion on a queue, if there is one
+ *
+ * @nvmeq:	The queue to check
+ * @result:	Returns the command-specific result, if not NULL
+ * @cid:	Returns the ID of the command which completed, if not NULL
+ * @return 0 if a command completed successfully, -EIO if it completed with
+ * an error, -EAGAIN if no command has completed yet
+ */
+static int nvme_reap_cmd(struct nvme_queue *nvmeq, u32 *result, u16 *cid)
 {
 	u16 head = nvmeq->cq_head;
 	u16 phase = nvmeq->cq_phase;
 	u16 status;
-	ulong start_time;
-	ulong timeout_us = timeout * 100000;
+	int ret = 0;
 
-	cmd->common.command_id = nvme_get_cmd_id();
-	nvme_submit_cmd(nvmeq, cmd);
-
-	start_time = timer_get_us();
-
-	for (;;) {
-		status = nvme_read_completion_status(nvmeq, head);
-		if ((status & 0x01) == phase)
-			break;
-		if (timeout_us > 0 && (timer_get_us() - start_time)
-		    >= timeout_us)
-			return -ETIMEDOUT;
-	}
+	status = nvme_read_completion_status(nvmeq, head);
+	if ((status & 0x01) != phase)
+		return -EAGAIN;
 
 	status >>= 1;
 	if (status) {
 		printf("ERROR: status = %x, phase = %d, head = %d\n",
 		       status, phase, head);
-		status = 0;
-		if (++head == nvmeq->q_depth) {
-			head = 0;
-			phase = !phase;
-		}
-		writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
-		nvmeq->cq_head = head;
-		nvmeq->cq_phase = phase;
-
-		return -EIO;
-	}
-
-	if (result)
+		ret = -EIO;
+	} else if (result) {
 		*result = readl(&(nvmeq->cqes[head].result));
+	}
+	if (cid)
+		*cid = readw(&(nvmeq->cqes[head].command_id));
 
 	if (++head == nvmeq->q_depth) {
 		head = 0;
@@ -231,7 +221,30 @@ static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
 	nvmeq->cq_head = head;
 	nvmeq->cq_phase = phase;
 
-	return status;
+	return ret;
+}
+
+static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
+				struct nvme_command *cmd,
+				u32 *result, unsigned timeout)
+{
+	ulong start_time;
+	ulong timeout_us = timeout * 100000;
+	int ret;
+
+	cmd->common.command_id = nvme_get_cmd_id();
+	nvme_submit_cmd(nvmeq, cmd);
+
+	start_time = timer_get_us();
+
+	for (;;) {
+		ret = nvme_reap_cmd(nvmeq, result, NULL);
+		if (ret != -EAGAIN)
+			return ret;
+		if (timeout_us > 0 && (timer_get_us() - start_time)
+		    >= timeout_us)
+			return -ETIMEDOUT;
+	}
 }
 
 static int nvme_submit_admin_cmd(struct nvme_dev *dev, struct nvme_command *cmd,
@@ -634,7 +647,8 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 	memcpy(dev->model, ctrl->mn, sizeof(ctrl->mn));
 	memcpy(dev->firmware_rev, ctrl->fr, sizeof(ctrl->fr));
 	if (ctrl->mdts)
-		dev->max_transfer_shift = (ctrl->mdts + shift);
+		dev->max_transfer_shift = min_t(u32, ctrl->mdts + shift,
+						NVME_MAX_TRANSFER_SHIFT);
 	else {
 		/*
 		 * Maximum Data Transfer Size (MDTS) field indicates the maximum
@@ -652,9 +666,11 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 		 *
 		 * In order for lbas not to overflow, the maximum number is 15
 		 * which means dev->max_transfer_shift = 15 + 9 (ns->lba_shift).
-		 * Let's use 20 which provides 1MB size.
+		 * Let's use 20 which provides 1MB size. This is also the upper
+		 * limit for controllers reporting a larger MDTS, as the PRP
+		 * list of each I/O slot is sized for it.
 		 */
-		dev->max_transfer_shift = 20;
+		dev->max_transfer_shift = NVME_MAX_TRANSFER_SHIFT;
 	}
 
 	free(ctrl);
@@ -732,65 +748,231 @@ static int nvme_blk_probe(struct udevice *udev)
 	return 0;
 }
 
-static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
-			 lbaint_t blkcnt, void *buffer, bool read)
+static void nvme_init_rw_cmd(struct nvme_ns *ns, struct nvme_command *c,
+			     bool read)
 {
-	struct nvme_ns *ns = dev_get_priv(udev);
-	struct nvme_dev *dev = ns->dev;
+	memset(c, 0, sizeof(*c));
+	c->rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
+	c->rw.nsid = cpu_to_le32(ns->ns_id);
+}
+
+/**
+ * nvme_async_issue() - send commands for an asynchronous request
+ *
+ * This sends as much of the request as there are free I/O slots for, each
+ * command covering up to the maximum transfer size, then rings the doorbell
+ * once for all of them.
+ *
+ * @dev:	NVMe device with a request in progress
+ * @return 0 if OK, -ve on error
+ */
+static int nvme_async_issue(struct nvme_dev *dev)
+{
+	struct nvme_async *async = &dev->async;
+	struct nvme_ns *ns = async->ns;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	u32 max_lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
 	struct nvme_command c;
-	struct blk_desc *desc = dev_get_uclass_plat(udev);
-	int status;
+	struct nvme_slot *slot;
+	bool queued = false;
+	int i, ret = 0;
+	u32 lbas;
 	u64 prp2;
-	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
-	uintptr_t temp_buffer = (uintptr_t)buffer;
-
-	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
-
-	flush_dcache_range((unsigned long)buffer,
-			   (unsigned long)buffer + total_len);
-
-	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
-	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
-		}
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, temp_buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
+	nvme_init_rw_cmd(ns, &c, !async->req->write);
+	for (i = 0; async->left && i < dev->nr_slots; i++) {
+		slot = &dev->slots[i];
+		if (slot->busy)
+			continue;
+
+		lbas = min_t(u64, async->left, max_lbas);
+		ret = nvme_setup_prps(dev, slot->prps, &prp2,
+				      lbas << ns->lba_shift, async->buf);
+		if (ret)
+			break;
+		c.rw.slba = cpu_to_le64(async->slba);
 		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64(temp_buffer);
+		c.rw.prp1 = cpu_to_le64(async->buf);
 		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
+		c.common.command_id = cpu_to_le16(i);
+		nvme_queue_cmd(nvmeq, &c);
+
+		slot->busy = true;
+		slot->req = async->req;
+		slot->blk = async->slba - async->req->start;
+		async->slba += lbas;
+		async->left -= lbas;
+		async->buf += (ulong)lbas << ns->lba_shift;
+		async->inflight++;
+		queued = true;
+	}
+
+	if (queued)
+		nvme_ring_sq(nvmeq);
+
+	return ret;
+}
+
+/**
+ * nvme_async_fail() - stop an asynchronous request at the given block
+ *
+ * No further commands are sent. The request completes once the commands
+ * already sent have finished, with only the blocks before the failure
+ * counted as transferred.
+ *
+ * @async:	Request state
+ * @blk:	Offset of the block which failed, within the request
+ */
+static void nvme_async_fail(struct nvme_async *async, u64 blk)
+{
+	if (blk < async->failed)
+		async->failed = blk;
+	async->left = 0;
+}
+
+/**
+ * nvme_async_poll() - make progress on the asynchronous request, if any
+ *
+ * This reaps any completed commands, refills the free slots from the rest
+ * of the request and completes the request when all of it is done or a
+ * command has failed.
+ *
+ * @dev:	NVMe device to poll
+ */
+static void nvme_async_poll(struct nvme_dev *dev)
+{
+	struct nvme_async *async = &dev->async;
+	struct blk_req *req = async->req;
+	struct nvme_slot *slot;
+	bool progress = false;
+	u16 cid;
+	int ret;
+	int i;
+
+	if (!req)
+		return;
+
+	for (;;) {
+		ret = nvme_reap_cmd(dev->queues[NVME_IO_Q], NULL, &cid);
+		if (ret == -EAGAIN)
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		temp_buffer += lbas << ns->lba_shift;
+		if (cid >= dev->nr_slots || !dev->slots[cid].busy)
+			continue;
+		slot = &dev->slots[cid];
+		slot->busy = false;
+		if (slot->req != req)
+			continue;
+
+		async->inflight--;
+		progress = true;
+		if (ret)
+			nvme_async_fail(async, slot->blk);
+	}
+
+	if (async->left && nvme_async_issue(dev))
+		nvme_async_fail(async, async->slba - req->start);
+
+	if (progress) {
+		async->start = timer_get_us();
+	} else if ((async->left || async->inflight) &&
+		   timer_get_us() - async->start >= IO_TIMEOUT * 100000) {
+		/*
+		 * Give up on the commands still outstanding. Their slots stay
+		 * busy until the controller completes them.
+		 */
+		nvme_async_fail(async, async->slba - req->start);
+		for (i = 0; i < dev->nr_slots; i++) {
+			slot = &dev->slots[i];
+			if (slot->busy && slot->req == req) {
+				nvme_async_fail(async, slot->blk);
+				slot->req = NULL;
+			}
+		}
+		async->inflight = 0;
+	}
+
+	if (async->left || async->inflight)
+		return;
+
+	if (!req->write)
+		invalidate_dcache_range((ulong)req->buffer,
+					(ulong)req->buffer + (req->blkcnt <<
+					async->ns->lba_shift));
+	req->result = async->failed;
+	req->done = true;
+	async->req = NULL;
+}
+
+/**
+ * nvme_async_start() - start a request on a namespace
+ *
+ * @ns:		Namespace to access
+ * @req:	Request to start
+ * @return 0 if OK, -EBUSY if another request is in progress, other -ve on
+ * error
+ */
+static int nvme_async_start(struct nvme_ns *ns, struct blk_req *req)
+{
+	struct nvme_dev *dev = ns->dev;
+	struct nvme_async *async = &dev->async;
+	int ret;
+
+	if (async->req)
+		return -EBUSY;
+	if (!req->blkcnt) {
+		req->result = 0;
+		req->done = true;
+		return 0;
 	}
 
-	if (read)
-		invalidate_dcache_range((unsigned long)buffer,
-					(unsigned long)buffer + total_len);
+	flush_dcache_range((ulong)req->buffer, (ulong)req->buffer +
+			   (req->blkcnt << ns->lba_shift));
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	async->req = req;
+	async->ns = ns;
+	async->slba = req->start;
+	async->left = req->blkcnt;
+	async->buf = (uintptr_t)req->buffer;
+	async->inflight = 0;
+	async->failed = req->blkcnt;
+	async->start = timer_get_us();
+
+	ret = nvme_async_issue(dev);
+	if (ret) {
+		if (!async->inflight) {
+			async->req = NULL;
+			return ret;
+		}
+		nvme_async_fail(async, async->slba - req->start);
+	}
+
+	return 0;
+}
+
+static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
+			 lbaint_t blkcnt, void *buffer, bool read)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+	struct blk_req req = {
+		.start	= blknr,
+		.blkcnt	= blkcnt,
+		.buffer	= buffer,
+		.write	= !read,
+	};
+	int ret;
+
+	/* Only one request is tracked at a time, so finish any other first */
+	while (dev->async.req)
+		nvme_async_poll(dev);
+
+	ret = nvme_async_start(ns, &req);
+	if (ret)
+		return ret;
+	while (!req.done)
+		nvme_async_poll(dev);
+
+	return req.result;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -805,9 +987,40 @@ static ulong nvme_blk_write(struct udevice *udev, lbaint_t blknr,
 	return nvme_blk_rw(udev, blknr, blkcnt, (void *)buffer, false);
 }
 
+static int nvme_blk_submit(struct udevice *udev, struct blk_req *req)
+{
+	return nvme_async_start(dev_get_priv(udev), req);
+}
+
+static int nvme_blk_poll(struct udevice *udev, struct blk_req *req)
+{
+	struct nvme_ns *ns = dev_get_priv(udev);
+	struct nvme_dev *dev = ns->dev;
+
+	if (req->done)
+		return 0;
+	if (dev->async.req != req)
+		return -EINVAL;
+	nvme_async_poll(dev);
+
+	return 0;
+}
+
+static int nvme_blk_get_queue_depth(struct udevice *udev)
+{
+	/*
+	 * Only one request is tracked at a time; it is spread over all the
+	 * slots of the I/O queue
+	 */
+	return 1;
+}
+
 static const struct blk_ops nvme_blk_ops = {
 	.read	= nvme_blk_read,
 	.write	= nvme_blk_write,
+	.submit	= nvme_blk_submit,
+	.poll	= nvme_blk_poll,
+	.get_queue_depth = nvme_blk_get_queue_depth,
 };
 
 U_BOOT_DRIVER(nvme_blk) = {
@@ -818,6 +1031,47 @@ U_BOOT_DRIVER(nvme_blk) = {
 	.priv_auto	= sizeof(struct nvme_ns),
 };
 
+/**
+ * nvme_alloc_slots() - allocate the I/O slots and their PRP lists
+ *
+ * There is one slot for each command which can be outstanding on the I/O
+ * queue. The PRP lists are allocated once here, large enough for the
+ * maximum transfer, so that reads and writes never need to allocate.
+ *
+ * @dev:	NVMe device
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+static int nvme_alloc_slots(struct nvme_dev *dev)
+{
+	u32 prps_per_page = dev->page_size >> 3;
+	u32 size;
+	int i;
+
+	dev->max_prps = (1 << dev->max_transfer_shift) / dev->page_size;
+	size = DIV_ROUND_UP(dev->max_prps, prps_per_page - 1) * dev->page_size;
+
+	dev->nr_slots = dev->q_depth - 1;
+	dev->slots = calloc(dev->nr_slots, sizeof(*dev->slots));
+	if (!dev->slots)
+		return -ENOMEM;
+
+	for (i = 0; i < dev->nr_slots; i++) {
+		dev->slots[i].prps = memalign(dev->page_size, size);
+		if (!dev->slots[i].prps)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	while (i--)
+		free(dev->slots[i].prps);
+	free(dev->slots);
+	dev->slots = NULL;
+
+	return -ENOMEM;
+}
+
 static int nvme_bind(struct udevice *udev)
 {
 	static int ndev_num;
@@ -862,21 +1116,19 @@ static int nvme_probe(struct udevice *udev)
 	if (ret)
 		goto free_queue;
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
-
 	ret = nvme_setup_io_queues(ndev);
 	if (ret)
 		goto free_queue;
 
 	nvme_get_info_from_identify(ndev);
 
+	/* Allocate after the page size and maximum transfer are known */
+	ret = nvme_alloc_slots(ndev);
+	if (ret) {
+		printf("Error: %s: Out of memory!\n", udev->name);
+		goto free_queue;
+	}
+
 	/* Create a blk device for each namespace */
 
 	id = memalign(ndev->page_size, sizeof(struct nvme_id_ns));
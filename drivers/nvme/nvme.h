@@ -595,6 +595,47 @@ enum {
 };
 
 /* Represents an NVM Express device. Each nvme_dev is a PCI function. */
+struct blk_req;
+struct nvme_ns;
+
+/**
+ * struct nvme_slot - a command slot on the I/O queue
+ *
+ * @prps:	PRP list for the command, sized for the maximum transfer
+ * @req:	Request the command belongs to, NULL if it was abandoned
+ * @blk:	Offset of the first block of the command within the request
+ * @busy:	true while the command is outstanding on the controller
+ */
+struct nvme_slot {
+	u64 *prps;
+	struct blk_req *req;
+	u64 blk;
+	bool busy;
+};
+
+/**
+ * struct nvme_async - state of a block request
+ *
+ * @req:	Request in progress, or NULL if none
+ * @ns:		Namespace the request is for
+ * @slba:	Block number for the next command
+ * @left:	Number of blocks not yet sent to the controller
+ * @buf:	Buffer address for the next command
+ * @inflight:	Number of commands of the request outstanding
+ * @failed:	Offset of the first block which failed, or the request size
+ * @start:	Time of the last completion (timer_get_us())
+ */
+struct nvme_async {
+	struct blk_req *req;
+	struct nvme_ns *ns;
+	u64 slba;
+	u64 left;
+	uintptr_t buf;
+	int inflight;
+	u64 failed;
+	ulong start;
+};
+
 struct nvme_dev {
 	struct list_head node;
 	struct nvme_queue **queues;
@@ -616,9 +657,11 @@ struct nvme_dev {
 	u32 stripe_size;
 	u32 page_size;
 	u8 vwc;
-	u64 *prp_pool;
-	u32 prp_entry_num;
+	struct nvme_slot *slots;
+	int nr_slots;
+	u32 max_prps;
 	u32 nn;
+	struct nvme_async async;
 };
 
 /*
@@ -730,7 +730,12 @@ again:
 	    (uintptr_t)xhci_virt_to_bus(ctrl, last_transfer_trb_addr)) {
 		available_length -=
 			(int)EVENT_TRB_LEN(le32_to_cpu(event->trans_event.transfer_len));
-		xhci_acknowledge_event(ctrl);
+		/*
+		 * The event for the last TRB of the TD follows, so only move
+		 * our dequeue pointer here and tell the hardware about both
+		 * events at once.
+		 */
+		inc_deq(ctrl, ctrl->event_ring);
 		goto again;
 	}
 
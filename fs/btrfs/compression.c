@@ -138,11 +138,17 @@ static u32 decompress_zlib(const u8 *_cbuf, u32 clen, u8 *dbuf, u32 dlen)
 static u32 decompress_zstd(const u8 *cbuf, u32 clen, u8 *dbuf, u32 dlen)
 {
 	struct abuf in, out;
+	int ret;
 
 	abuf_init_set(&in, (u8 *)cbuf, clen);
 	abuf_init_set(&out, dbuf, dlen);
 
-	return zstd_decompress(&in, &out);
+	/* Callers only recognise (u32)-1 as an error */
+	ret = zstd_decompress(&in, &out);
+	if (ret < 0)
+		return -1;
+
+	return ret;
 }
 
 u32 btrfs_decompress(u8 type, const char *c, u32 clen, char *d, u32 dlen)
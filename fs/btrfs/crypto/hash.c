@@ -13,7 +13,7 @@ void btrfs_hash_init(void)
 	static int inited = 0;
 
 	if (!inited) {
-		crc32c_init(btrfs_crc32c_table, 0x82F63B78);
+		crc32c_init(btrfs_crc32c_table, CRC32C_POLY_LE);
 		inited = 1;
 	}
 }
@@ -43,7 +43,8 @@ int hash_crc32c(const u8 *buf, size_t length, u8 *out)
 {
 	u32 crc;
 
-	crc = crc32c_cal((u32)~0, (char *)buf, length, btrfs_crc32c_table);
+	crc = crc32c_castagnoli((u32)~0, (char *)buf, length,
+				btrfs_crc32c_table);
 	put_unaligned_le32(~crc, out);
 
 	return 0;
@@ -51,5 +52,5 @@ int hash_crc32c(const u8 *buf, size_t length, u8 *out)
 
 u32 crc32c(u32 seed, const void * data, size_t len)
 {
-	return crc32c_cal(seed, data, len, btrfs_crc32c_table);
+	return crc32c_castagnoli(seed, data, len, btrfs_crc32c_table);
 }
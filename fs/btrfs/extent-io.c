@@ -18,7 +18,9 @@ void extent_io_tree_init(struct extent_io_tree *tree)
 {
 	cache_tree_init(&tree->state);
 	cache_tree_init(&tree->cache);
+	INIT_LIST_HEAD(&tree->lru);
 	tree->cache_size = 0;
+	tree->max_cache_size = BTRFS_EB_CACHE_SIZE;
 }
 
 static struct extent_state *alloc_extent_state(void)
@@ -54,6 +56,12 @@ static void free_extent_state_func(struct cache_extent *cache)
 static void free_extent_buffer_final(struct extent_buffer *eb);
 void extent_io_tree_cleanup(struct extent_io_tree *tree)
 {
+	struct extent_buffer *eb, *tmp;
+
+	list_for_each_entry_safe(eb, tmp, &tree->lru, lru) {
+		if (!eb->refs)
+			free_extent_buffer_final(eb);
+	}
 	cache_tree_free_extents(&tree->state, free_extent_state_func);
 }
 
@@ -579,6 +587,7 @@ static struct extent_buffer *__alloc_extent_buffer(struct btrfs_fs_info *info,
 	eb->len = blocksize;
 	eb->refs = 1;
 	eb->flags = 0;
+	INIT_LIST_HEAD(&eb->lru);
 	eb->cache_node.start = bytenr;
 	eb->cache_node.size = blocksize;
 	eb->fs_info = info;
@@ -607,6 +616,7 @@ static void free_extent_buffer_final(struct extent_buffer *eb)
 	if (!(eb->flags & EXTENT_BUFFER_DUMMY)) {
 		struct extent_io_tree *tree = &eb->fs_info->extent_cache;
 
+		list_del_init(&eb->lru);
 		remove_cache_extent(&tree->cache, &eb->cache_node);
 		BUG_ON(tree->cache_size < eb->len);
 		tree->cache_size -= eb->len;
@@ -633,11 +643,31 @@ static void free_extent_buffer_internal(struct extent_buffer *eb, bool free_now)
 	}
 }
 
+/* Drop a reference, keeping the eb cached for later lookups */
 void free_extent_buffer(struct extent_buffer *eb)
+{
+	free_extent_buffer_internal(eb, 0);
+}
+
+/* Drop a reference and free the eb if it was the last one */
+void free_extent_buffer_nocache(struct extent_buffer *eb)
 {
 	free_extent_buffer_internal(eb, 1);
 }
 
+/* Free unreferenced ebs, least recently used first, to make room */
+static void trim_extent_buffer_cache(struct extent_io_tree *tree)
+{
+	struct extent_buffer *eb, *tmp;
+
+	list_for_each_entry_safe(eb, tmp, &tree->lru, lru) {
+		if (eb->refs == 0)
+			free_extent_buffer_final(eb);
+		if (tree->cache_size <= ((tree->max_cache_size * 9) / 10))
+			break;
+	}
+}
+
 struct extent_buffer *find_extent_buffer(struct extent_io_tree *tree,
 					 u64 bytenr, u32 blocksize)
 {
@@ -648,6 +678,7 @@ struct extent_buffer *find_extent_buffer(struct extent_io_tree *tree,
 	if (cache && cache->start == bytenr &&
 	    cache->size == blocksize) {
 		eb = container_of(cache, struct extent_buffer, cache_node);
+		list_move_tail(&eb->lru, &tree->lru);
 		eb->refs++;
 	}
 	return eb;
@@ -678,6 +709,7 @@ struct extent_buffer *alloc_extent_buffer(struct btrfs_fs_info *fs_info,
 	if (cache && cache->start == bytenr &&
 	    cache->size == blocksize) {
 		eb = container_of(cache, struct extent_buffer, cache_node);
+		list_move_tail(&eb->lru, &tree->lru);
 		eb->refs++;
 	} else {
 		int ret;
@@ -685,17 +717,25 @@ struct extent_buffer *alloc_extent_buffer(struct btrfs_fs_info *fs_info,
 		if (cache) {
 			eb = container_of(cache, struct extent_buffer,
 					  cache_node);
-			free_extent_buffer(eb);
+			/* An unreferenced overlapping eb is only cached */
+			if (eb->refs)
+				free_extent_buffer_nocache(eb);
+			else
+				free_extent_buffer_final(eb);
 		}
 		eb = __alloc_extent_buffer(fs_info, bytenr, blocksize);
 		if (!eb)
 			return NULL;
 		ret = insert_cache_extent(&tree->cache, &eb->cache_node);
 		if (ret) {
+			free(eb->data);
 			free(eb);
 			return NULL;
 		}
+		list_add_tail(&eb->lru, &tree->lru);
 		tree->cache_size += blocksize;
+		if (tree->cache_size >= tree->max_cache_size)
+			trim_extent_buffer_cache(tree);
 	}
 	return eb;
 }
@@ -6,9 +6,9 @@
  * Modification includes:
  * - extent_buffer:data
  *   Use pointer to provide better alignment.
- * - Remove max_cache_size related interfaces
- *   Includes free_extent_buffer_nocache()
- *   As we don't cache eb in U-boot.
+ * - Fixed size eb cache
+ *   Unreferenced ebs stay cached on an LRU list until BTRFS_EB_CACHE_SIZE
+ *   is exceeded, instead of using a size based on total RAM.
  * - Include headers
  *
  * Write related functions are kept as we still need to modify dummy extent
@@ -21,6 +21,7 @@
 #include <linux/list.h>
 #include <linux/err.h>
 #include <linux/bitops.h>
+#include <linux/sizes.h>
 #include <fs_internal.h>
 #include "extent-cache.h"
 
@@ -63,10 +64,15 @@ static inline int le_test_bit(int nr, const u8 *addr)
 
 struct btrfs_fs_info;
 
+/* Bytes of tree blocks kept in the extent buffer cache of a mount */
+#define BTRFS_EB_CACHE_SIZE	SZ_4M
+
 struct extent_io_tree {
 	struct cache_tree state;
 	struct cache_tree cache;
+	struct list_head lru;
 	u64 cache_size;
+	u64 max_cache_size;
 };
 
 struct extent_state {
@@ -84,6 +90,7 @@ struct extent_buffer {
 	u32 len;
 	int refs;
 	u32 flags;
+	struct list_head lru;
 	struct btrfs_fs_info *fs_info;
 	char *data;
 };
@@ -136,6 +143,7 @@ struct extent_buffer *btrfs_clone_extent_buffer(struct extent_buffer *src);
 struct extent_buffer *alloc_dummy_extent_buffer(struct btrfs_fs_info *fs_info,
 						u64 bytenr, u32 blocksize);
 void free_extent_buffer(struct extent_buffer *eb);
+void free_extent_buffer_nocache(struct extent_buffer *eb);
 int read_extent_from_disk(struct blk_desc *desc, struct disk_partition *part,
 			  u64 physical, struct extent_buffer *eb,
 			  unsigned long offset, unsigned long len);
@@ -408,6 +408,42 @@ out:
 	return ret;
 }
 
+/*
+ * Read @len bytes of uncompressed data at @logical into @dest, trying each
+ * mirror in turn. The range may cover several file extents and cross chunk
+ * boundaries.
+ *
+ * Return 0 for success.
+ * Return <0 for error.
+ */
+static int read_data_range(struct btrfs_fs_info *fs_info, u64 logical,
+			   u64 len, char *dest)
+{
+	int num_copies;
+	u64 read;
+	int ret;
+	int i;
+
+	while (len) {
+		num_copies = btrfs_num_copies(fs_info, logical, len);
+		ret = -EIO;
+		for (i = 1; i <= num_copies; i++) {
+			read = len;
+			ret = read_extent_data(fs_info, dest, logical, &read,
+					       i);
+			if (ret < 0 || !read)
+				continue;
+			break;
+		}
+		if (ret < 0 || !read)
+			return -EIO;
+		logical += read;
+		dest += read;
+		len -= read;
+	}
+	return 0;
+}
+
 /*
  * Read out regular extent.
  *
@@ -426,6 +462,7 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	struct btrfs_key key;
 	u64 extent_num_bytes;
 	u64 disk_bytenr;
+	u64 dstart;
 	u64 read;
 	char *cbuf = NULL;
 	char *dbuf = NULL;
@@ -457,18 +494,9 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 		logical = btrfs_file_extent_disk_bytenr(leaf, fi) +
 			  btrfs_file_extent_offset(leaf, fi) +
 			  offset - key.offset;
-		read = len;
-
-		num_copies = btrfs_num_copies(fs_info, logical, len);
-		for (i = 1; i <= num_copies; i++) {
-			ret = read_extent_data(fs_info, dest, logical, &read, i);
-			if (ret < 0 || read != len)
-				continue;
-			finished = true;
-			break;
-		}
-		if (!finished)
-			return -EIO;
+		ret = read_data_range(fs_info, logical, len, dest);
+		if (ret < 0)
+			return ret;
 		return len;
 	}
 
@@ -476,13 +504,26 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	dsize = btrfs_file_extent_ram_bytes(leaf, fi);
 	disk_bytenr = btrfs_file_extent_disk_bytenr(leaf, fi);
 	num_copies = btrfs_num_copies(fs_info, disk_bytenr, csize);
+	dstart = btrfs_file_extent_offset(leaf, fi) + offset - key.offset;
 
 	cbuf = malloc_cache_aligned(csize);
-	dbuf = malloc_cache_aligned(dsize);
-	if (!cbuf || !dbuf) {
+	if (!cbuf) {
 		ret = -ENOMEM;
 		goto out;
 	}
+	/*
+	 * If the whole decompressed extent is wanted, decompress it straight
+	 * into @dest.
+	 */
+	if (dstart == 0 && len == dsize) {
+		dbuf = dest;
+	} else {
+		dbuf = malloc_cache_aligned(dsize);
+		if (!dbuf) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
 	/* For compressed extent, we must read the whole on-disk extent */
 	for (i = 1; i <= num_copies; i++) {
 		read = csize;
@@ -511,11 +552,13 @@ int btrfs_read_extent_reg(struct btrfs_path *path,
 	if (ret < dsize)
 		memset(dbuf + ret, 0, dsize - ret);
 	/* Then copy the needed part */
-	memcpy(dest, dbuf + btrfs_file_extent_offset(leaf, fi), len);
+	if (dbuf != dest)
+		memcpy(dest, dbuf + dstart, len);
 	ret = len;
 out:
 	free(cbuf);
-	free(dbuf);
+	if (dbuf != dest)
+		free(dbuf);
 	return ret;
 }
 
@@ -669,6 +712,9 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 	u64 aligned_end = round_down(file_offset + len, fs_info->sectorsize);
 	u64 next_offset;
 	u64 cur = aligned_start;
+	u64 run_logical = 0;
+	u64 run_len = 0;
+	char *run_dest = NULL;
 	int ret = 0;
 
 	btrfs_init_path(&path);
@@ -702,9 +748,14 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 		}
 	}
 
-	/* Read the aligned part */
+	/*
+	 * Read the aligned part. Uncompressed extents which follow each other
+	 * on disk are merged into a single read.
+	 */
 	while (cur < aligned_end) {
 		u64 extent_num_bytes;
+		u64 read_len;
+		u64 logical;
 		u8 type;
 
 		btrfs_release_path(&path);
@@ -712,11 +763,12 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 		if (ret < 0)
 			goto out;
 		if (ret > 0) {
-			/* No next, direct exit */
-			if (!next_offset) {
-				ret = 0;
-				goto out;
-			}
+			/* No next, the rest is a hole */
+			if (!next_offset)
+				break;
+			/* Skip the hole, as we have zeroed the dest */
+			cur = next_offset;
+			continue;
 		}
 		fi = btrfs_item_ptr(path.nodes[0], path.slots[0],
 				    struct btrfs_file_extent_item);
@@ -726,24 +778,48 @@ int btrfs_file_read(struct btrfs_root *root, u64 ino, u64 file_offset, u64 len,
 			ret = btrfs_read_extent_inline(&path, fi, dest);
 			goto out;
 		}
+		extent_num_bytes = btrfs_file_extent_num_bytes(path.nodes[0],
+							       fi);
 		/* Skip holes, as we have zeroed the dest */
 		if (type == BTRFS_FILE_EXTENT_PREALLOC ||
 		    btrfs_file_extent_disk_bytenr(path.nodes[0], fi) == 0) {
-			cur = key.offset + btrfs_file_extent_num_bytes(
-					path.nodes[0], fi);
+			cur = key.offset + extent_num_bytes;
 			continue;
 		}
 
 		/* Read the remaining part of the extent */
-		extent_num_bytes = btrfs_file_extent_num_bytes(path.nodes[0],
-							       fi);
-		ret = btrfs_read_extent_reg(&path, fi, cur,
-				min(extent_num_bytes, aligned_end - cur),
-				dest + cur - file_offset);
-		if (ret < 0)
-			goto out;
-		cur += min(extent_num_bytes, aligned_end - cur);
+		read_len = min(key.offset + extent_num_bytes - cur,
+			       aligned_end - cur);
+		if (btrfs_file_extent_compression(path.nodes[0], fi) !=
+		    BTRFS_COMPRESS_NONE) {
+			ret = btrfs_read_extent_reg(&path, fi, cur, read_len,
+						    dest + cur - file_offset);
+			if (ret < 0)
+				goto out;
+			cur += read_len;
+			continue;
+		}
+
+		logical = btrfs_file_extent_disk_bytenr(path.nodes[0], fi) +
+			  btrfs_file_extent_offset(path.nodes[0], fi) +
+			  cur - key.offset;
+		if (run_len && run_logical + run_len == logical &&
+		    run_dest + run_len == dest + cur - file_offset) {
+			run_len += read_len;
+		} else {
+			ret = read_data_range(fs_info, run_logical, run_len,
+					      run_dest);
+			if (ret < 0)
+				goto out;
+			run_logical = logical;
+			run_dest = dest + cur - file_offset;
+			run_len = read_len;
+		}
+		cur += read_len;
 	}
+	ret = read_data_range(fs_info, run_logical, run_len, run_dest);
+	if (ret < 0)
+		goto out;
 
 	/* Read the tailing unaligned part*/
 	if (file_offset + len != aligned_end) {
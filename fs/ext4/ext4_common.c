@@ -1566,6 +1566,129 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 	}
 }
 
+/* Deepest extent tree accepted by ext4fs_map_extents() */
+#define EXT4_EXT_MAX_DEPTH	5
+
+/* Extents with a larger ee_len are unwritten (preallocated) */
+#define EXT4_EXT_INIT_MAX_LEN	(1U << 15)
+
+struct ext4_map_ctx {
+	uint32_t first;
+	uint32_t last;
+	struct ext4_extent_map *map;
+	int count;
+	int size;
+};
+
+static int ext4fs_map_add(struct ext4_map_ctx *ctx, uint32_t lblk,
+			  uint32_t len, uint64_t pblk)
+{
+	struct ext4_extent_map *map;
+
+	if (ctx->count == ctx->size) {
+		ctx->size = ctx->size ? ctx->size * 2 : 16;
+		map = realloc(ctx->map, ctx->size * sizeof(*map));
+		if (!map)
+			return -ENOMEM;
+		ctx->map = map;
+	}
+	map = &ctx->map[ctx->count++];
+	map->lblk = lblk;
+	map->len = len;
+	map->pblk = pblk;
+
+	return 0;
+}
+
+static int ext4fs_map_node(struct ext4_map_ctx *ctx,
+			   struct ext4_extent_header *ext_block, int level)
+{
+	int log2_blksz = LOG2_BLOCK_SIZE(ext4fs_root) -
+		get_fs()->dev_desc->log2blksz;
+	int blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	int entries = le16_to_cpu(ext_block->eh_entries);
+	struct ext4_extent_idx *index;
+	struct ext4_extent *extent;
+	uint64_t block;
+	char *buf;
+	int i, ret;
+
+	if (le16_to_cpu(ext_block->eh_magic) != EXT4_EXT_MAGIC ||
+	    level > EXT4_EXT_MAX_DEPTH)
+		return -EINVAL;
+
+	if (ext_block->eh_depth == 0) {
+		extent = (struct ext4_extent *)(ext_block + 1);
+		for (i = 0; i < entries; i++) {
+			uint32_t lblk = le32_to_cpu(extent[i].ee_block);
+			uint32_t len = le16_to_cpu(extent[i].ee_len);
+
+			block = le16_to_cpu(extent[i].ee_start_hi);
+			block = (block << 32) +
+				le32_to_cpu(extent[i].ee_start_lo);
+			if (len > EXT4_EXT_INIT_MAX_LEN) {
+				/* unwritten extents read as zeroes */
+				len -= EXT4_EXT_INIT_MAX_LEN;
+				block = 0;
+			}
+			if (lblk > ctx->last)
+				break;
+			if (lblk + len <= ctx->first)
+				continue;
+			ret = ext4fs_map_add(ctx, lblk, len, block);
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+
+	buf = zalloc(blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	index = (struct ext4_extent_idx *)(ext_block + 1);
+	for (i = 0, ret = 0; i < entries && !ret; i++) {
+		if (le32_to_cpu(index[i].ei_block) > ctx->last)
+			break;
+		if (i + 1 < entries &&
+		    le32_to_cpu(index[i + 1].ei_block) <= ctx->first)
+			continue;
+
+		block = le16_to_cpu(index[i].ei_leaf_hi);
+		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
+		if (!ext4fs_devread((lbaint_t)block << log2_blksz, 0, blksz,
+				    buf))
+			ret = -EIO;
+		else
+			ret = ext4fs_map_node(ctx,
+					      (struct ext4_extent_header *)buf,
+					      level + 1);
+	}
+	free(buf);
+
+	return ret;
+}
+
+int ext4fs_map_extents(struct ext2_inode *inode, uint32_t first,
+		       uint32_t last, struct ext4_extent_map **mapp)
+{
+	struct ext4_map_ctx ctx = {
+		.first = first,
+		.last = last,
+	};
+	int ret;
+
+	ret = ext4fs_map_node(&ctx, (struct ext4_extent_header *)
+			      inode->b.blocks.dir_blocks, 0);
+	if (ret) {
+		free(ctx.map);
+		return ret;
+	}
+	*mapp = ctx.map;
+
+	return ctx.count;
+}
+
 static int ext4fs_blockgroup
 	(struct ext2_data *data, int group, struct ext2_block_group *blkgrp)
 {
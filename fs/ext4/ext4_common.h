@@ -48,8 +48,32 @@ static inline void *zalloc(size_t size)
 	return p;
 }
 
+/*
+ * A run of file blocks mapped by a leaf of the extent tree
+ */
+struct ext4_extent_map {
+	uint32_t lblk;		/* first file block */
+	uint32_t len;		/* number of blocks */
+	uint64_t pblk;		/* first physical block, 0 if not written */
+};
+
 int ext4fs_read_inode(struct ext2_data *data, int ino,
 		      struct ext2_inode *inode);
+/**
+ * ext4fs_map_extents() - map a range of an extent-based file
+ *
+ * Walk the extent tree of @inode, reading each node needed only once, and
+ * collect the leaf extents which overlap file blocks @first to @last, in
+ * file order. Holes are not included.
+ *
+ * @inode:	inode with EXT4_EXTENTS_FL set
+ * @first:	first file block wanted
+ * @last:	last file block wanted
+ * @mapp:	returns a malloc()ed array of extents, to be freed by the caller
+ * Return:	number of extents in *@mapp, or -ve on error
+ */
+int ext4fs_map_extents(struct ext2_inode *inode, uint32_t first,
+		       uint32_t last, struct ext4_extent_map **mapp);
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos, loff_t len,
 		     char *buf, loff_t *actread);
 int ext4fs_find_file(const char *path, struct ext2fs_node *rootnode,
@@ -44,6 +44,76 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/* Largest single device read issued by ext4fs_read_extents() */
+#define EXT4_MAX_DEVREAD	(1 << 30)
+
+/*
+ * Read an extent-based file by mapping the requested range once and then
+ * reading each physically contiguous extent straight into @buf. Holes and
+ * unwritten extents are zero-filled.
+ */
+static int ext4fs_read_extents(struct ext2fs_node *node, loff_t pos,
+			       loff_t len, char *buf)
+{
+	struct ext_filesystem *fs = get_fs();
+	int log2_blocksize = LOG2_BLOCK_SIZE(node->data);
+	int log2_fs_blocksize = log2_blocksize - fs->dev_desc->log2blksz;
+	loff_t end = pos + len;
+	loff_t cur = pos;
+	struct ext4_extent_map *map;
+	int count, i;
+
+	count = ext4fs_map_extents(&node->inode, pos >> log2_blocksize,
+				   (end - 1) >> log2_blocksize, &map);
+	if (count < 0)
+		return -1;
+
+	for (i = 0; i < count && cur < end; i++) {
+		loff_t ext_start = (loff_t)map[i].lblk << log2_blocksize;
+		loff_t ext_end = ext_start +
+			((loff_t)map[i].len << log2_blocksize);
+		loff_t n;
+
+		if (ext_end <= cur)
+			continue;
+		if (ext_start > cur) {
+			n = min(ext_start, end) - cur;
+			memset(buf + (cur - pos), 0, n);
+			cur += n;
+			if (cur >= end)
+				break;
+		}
+
+		n = min(ext_end, end) - cur;
+		if (!map[i].pblk) {
+			memset(buf + (cur - pos), 0, n);
+			cur += n;
+			continue;
+		}
+		while (n) {
+			loff_t off = cur - ext_start;
+			lbaint_t sector = (map[i].pblk +
+					   (off >> log2_blocksize)) <<
+					  log2_fs_blocksize;
+			int chunk = min_t(loff_t, n, EXT4_MAX_DEVREAD);
+
+			if (!ext4fs_devread(sector,
+					    off & ((1 << log2_blocksize) - 1),
+					    chunk, buf + (cur - pos))) {
+				free(map);
+				return -1;
+			}
+			cur += chunk;
+			n -= chunk;
+		}
+	}
+	if (cur < end)
+		memset(buf + (cur - pos), 0, end - cur);
+	free(map);
+
+	return 0;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
@@ -80,6 +150,14 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		return -1;
 	}
 
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		ext_cache_fini(&cache);
+		if (ext4fs_read_extents(node, pos, len, buf))
+			return -1;
+		*actread = len;
+		return 0;
+	}
+
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
 	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
@@ -14,6 +14,7 @@
 #include <exports.h>
 #include <fat.h>
 #include <fs.h>
+#include <fs_internal.h>
 #include <log.h>
 #include <asm/byteorder.h>
 #include <part.h>
@@ -23,6 +24,11 @@
 #include <linux/compiler.h>
 #include <linux/ctype.h>
 
+/* A FAT12 entry must not straddle two buffer loads in get_fatent() */
+#if FATBUFBLOCKS % 3
+#error "CONFIG_FS_FAT_BUF_SECTORS must be a multiple of 3"
+#endif
+
 /*
  * Convert a string to lowercase.  Converts at most 'len' characters,
  * 'len' may be larger than the length of 'str' if 'str' is NULL
@@ -259,27 +265,18 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 
 	debug("gc - clustnum: %d, startsect: %d\n", clustnum, startsect);
 
-	if ((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1)) {
-		ALLOC_CACHE_ALIGN_BUFFER(__u8, tmpbuf, mydata->sect_size);
-
-		debug("FAT: Misaligned buffer address (%p)\n", buffer);
-
-		while (size >= mydata->sect_size) {
-			ret = disk_read(startsect++, 1, tmpbuf);
-			if (ret != 1) {
-				debug("Error reading data (got %d)\n", ret);
-				return -1;
-			}
+	if (!cur_dev)
+		return -1;
 
-			memcpy(buffer, tmpbuf, mydata->sect_size);
-			buffer += mydata->sect_size;
-			size -= mydata->sect_size;
-		}
-	} else if (size >= mydata->sect_size) {
+	if (size >= mydata->sect_size) {
 		__u32 bytes_read;
 		__u32 sect_count = size / mydata->sect_size;
 
-		ret = disk_read(startsect, sect_count, buffer);
+		if ((unsigned long)buffer & (ARCH_DMA_MINALIGN - 1))
+			debug("FAT: Misaligned buffer address (%p)\n", buffer);
+
+		ret = fs_blk_dread(cur_dev, cur_part_info.start + startsect,
+				   sect_count, buffer);
 		if (ret != sect_count) {
 			debug("Error reading data (got %d)\n", ret);
 			return -1;
@@ -299,11 +296,67 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 		}
 
 		memcpy(buffer, tmpbuf, size);
+		fs_add_bounced(size);
 	}
 
 	return 0;
 }
 
+/*
+ * A run of consecutive clusters in a cluster chain
+ */
+struct fat_extent {
+	__u32 clust;	/* first cluster in the run */
+	__u32 count;	/* number of clusters in the run */
+};
+
+/* Number of extents mapped from the FAT at a time by get_contents() */
+#define FAT_EXTENTS	32
+
+/**
+ * get_extents() - map part of a cluster chain to runs of consecutive clusters
+ *
+ * Walk the cluster chain from @clust, merging consecutive clusters into
+ * extents, until @nclust clusters are mapped or @ext is full.
+ *
+ * @mydata:	file system description
+ * @clust:	first cluster to map
+ * @nclust:	number of clusters wanted, at least 1
+ * @ext:	array of FAT_EXTENTS extents to fill in
+ * @lastclust:	returns the last cluster which was mapped
+ * Return:	number of extents filled in, or -1 on an invalid FAT entry
+ */
+static int get_extents(fsdata *mydata, __u32 clust, __u32 nclust,
+		       struct fat_extent *ext, __u32 *lastclust)
+{
+	__u32 newclust;
+	int n = 0;
+
+	ext[0].clust = clust;
+	ext[0].count = 1;
+	while (--nclust) {
+		newclust = get_fatent(mydata, clust);
+		if (CHECK_CLUST(newclust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", newclust);
+			printf("Invalid FAT entry\n");
+			return -1;
+		}
+		if (newclust == clust + 1) {
+			ext[n].count++;
+		} else {
+			if (n + 1 == FAT_EXTENTS)
+				break;
+			n++;
+			ext[n].clust = newclust;
+			ext[n].count = 1;
+		}
+		clust = newclust;
+	}
+	*lastclust = clust;
+
+	return n + 1;
+}
+
 /**
  * get_contents() - read from file
  *
@@ -311,6 +364,10 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
  * into 'buffer'. Update the number of bytes read in *gotsize or return -1 on
  * fatal errors.
  *
+ * The cluster chain is mapped to extents a window at a time, so that each
+ * run of consecutive clusters is read with a single disk read straight into
+ * 'buffer'.
+ *
  * @mydata:	file system description
  * @dentprt:	directory entry pointer
  * @pos:	position from where to read
@@ -325,8 +382,10 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
 	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_extent ext[FAT_EXTENTS];
+	__u32 lastclust;
 	loff_t actsize;
+	int i, n;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -392,49 +451,36 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 		}
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
 	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
+		n = get_extents(mydata, curclust,
+				DIV_ROUND_UP(filesize, bytesperclust), ext,
+				&lastclust);
+		if (n < 0)
+			return -1;
+
+		for (i = 0; i < n; i++) {
+			actsize = min(filesize,
+				      (loff_t)ext[i].count * bytesperclust);
+			debug("extent: clust 0x%x, %llu bytes\n", ext[i].clust,
+			      actsize);
+			if (get_cluster(mydata, ext[i].clust, buffer,
+					actsize) != 0) {
+				printf("Error reading cluster\n");
 				return -1;
 			}
-			endclust = newclust;
-			actsize += bytesperclust;
+			*gotsize += actsize;
+			filesize -= actsize;
+			buffer += actsize;
 		}
+		if (!filesize)
+			return 0;
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
-		filesize -= actsize;
-		buffer += actsize;
-
-		curclust = get_fatent(mydata, endclust);
+		curclust = get_fatent(mydata, lastclust);
 		if (CHECK_CLUST(curclust, mydata->fatsize)) {
 			debug("curclust: 0x%x\n", curclust);
 			printf("Invalid FAT entry\n");
 			return -1;
 		}
-		actsize = bytesperclust;
-		endclust = curclust;
 	} while (1);
 }
 
@@ -17,6 +17,7 @@
 #include <ext4fs.h>
 #include <fat.h>
 #include <fs.h>
+#include <fs_internal.h>
 #include <sandboxfs.h>
 #include <ubifs_uboot.h>
 #include <btrfs.h>
@@ -33,6 +34,233 @@ static struct blk_desc *fs_dev_desc;
 static int fs_dev_part;
 static struct disk_partition fs_partition;
 static int fs_type = FS_TYPE_ANY;
+static bool fs_probed;
+
+/* Longest path remembered by the lookup cache */
+#define FS_CACHE_NAME_LEN	128
+
+/**
+ * struct fs_dentry_cache - result of looking up a path
+ *
+ * @name:	path as passed to fs_exists(), fs_size() or fs_read()
+ * @size:	size of the file, or -1 if not known yet
+ * @exists:	true if the path was found
+ * @age:	time of last use, for LRU replacement
+ */
+struct fs_dentry_cache {
+	char name[FS_CACHE_NAME_LEN];
+	loff_t size;
+	bool exists;
+	uint age;
+};
+
+#if CONFIG_IS_ENABLED(FS_CACHE)
+/**
+ * struct fs_mount_cache - filesystem found on a partition
+ *
+ * The block device is identified by its interface type and number rather
+ * than its descriptor, which is freed when the device is removed.
+ *
+ * @if_type:	interface type of the block device (IF_TYPE_...)
+ * @devnum:	device number on that interface
+ * @start:	first block of the partition
+ * @size:	number of blocks in the partition
+ * @fstype:	FS_TYPE_x found by the last successful probe
+ * @age:	time of last use, for LRU replacement
+ * @dentries:	paths looked up on this filesystem
+ */
+struct fs_mount_cache {
+	int if_type;
+	int devnum;
+	lbaint_t start;
+	lbaint_t size;
+	int fstype;
+	uint age;
+	struct fs_dentry_cache dentries[CONFIG_FS_CACHE_DENTRIES];
+};
+
+static struct fs_mount_cache fs_mounts[CONFIG_FS_CACHE_MOUNTS];
+static struct fs_mount_cache *fs_mount_cur;
+static uint fs_cache_age;
+
+/* Check whether @mnt is in use and describes the current partition */
+static bool fs_cache_is_cur(struct fs_mount_cache *mnt)
+{
+	return mnt->age && mnt->if_type == fs_dev_desc->if_type &&
+		mnt->devnum == fs_dev_desc->devnum &&
+		mnt->start == fs_partition.start &&
+		mnt->size == fs_partition.size;
+}
+
+/*
+ * Select the current partition from the mount cache. On a hit the probe is
+ * deferred to fs_mount(), so commands answered from the lookup cache never
+ * touch the filesystem.
+ */
+static bool fs_cache_mount(int fstype)
+{
+	struct fs_mount_cache *mnt;
+	int i;
+
+	fs_mount_cur = NULL;
+	if (!fs_dev_desc)
+		return false;
+
+	for (i = 0, mnt = fs_mounts; i < ARRAY_SIZE(fs_mounts); i++, mnt++) {
+		if (!fs_cache_is_cur(mnt))
+			continue;
+		if (fstype != FS_TYPE_ANY && fstype != mnt->fstype)
+			return false;
+
+		mnt->age = ++fs_cache_age;
+		fs_mount_cur = mnt;
+		fs_type = mnt->fstype;
+		fs_probed = false;
+		return true;
+	}
+
+	return false;
+}
+
+/* Remember the filesystem just probed on the current partition */
+static void fs_cache_add_mount(void)
+{
+	struct fs_mount_cache *mnt, *victim = fs_mounts;
+	int i;
+
+	if (!fs_dev_desc)
+		return;
+
+	for (i = 0, mnt = fs_mounts; i < ARRAY_SIZE(fs_mounts); i++, mnt++) {
+		if (fs_cache_is_cur(mnt)) {
+			victim = mnt;
+			break;
+		}
+		if (mnt->age < victim->age)
+			victim = mnt;
+	}
+
+	memset(victim, '\0', sizeof(*victim));
+	victim->if_type = fs_dev_desc->if_type;
+	victim->devnum = fs_dev_desc->devnum;
+	victim->start = fs_partition.start;
+	victim->size = fs_partition.size;
+	victim->fstype = fs_type;
+	victim->age = ++fs_cache_age;
+	fs_mount_cur = victim;
+}
+
+static void fs_cache_close(void)
+{
+	fs_mount_cur = NULL;
+}
+
+static void fs_cache_drop_mount(void)
+{
+	if (fs_mount_cur)
+		memset(fs_mount_cur, '\0', sizeof(*fs_mount_cur));
+	fs_mount_cur = NULL;
+}
+
+/* Forget all lookups on the current filesystem, e.g. after a write */
+static void fs_cache_forget(void)
+{
+	if (fs_mount_cur)
+		memset(fs_mount_cur->dentries, '\0',
+		       sizeof(fs_mount_cur->dentries));
+}
+
+static struct fs_dentry_cache *fs_cache_lookup(const char *name)
+{
+	struct fs_dentry_cache *dent;
+	int i;
+
+	if (!fs_mount_cur)
+		return NULL;
+
+	dent = fs_mount_cur->dentries;
+	for (i = 0; i < CONFIG_FS_CACHE_DENTRIES; i++, dent++) {
+		if (dent->age && !strcmp(dent->name, name)) {
+			dent->age = ++fs_cache_age;
+			return dent;
+		}
+	}
+
+	return NULL;
+}
+
+static void fs_cache_store(const char *name, bool exists, loff_t size)
+{
+	struct fs_dentry_cache *dent, *victim;
+	int i;
+
+	if (!fs_mount_cur || strlen(name) >= FS_CACHE_NAME_LEN)
+		return;
+
+	victim = fs_cache_lookup(name);
+	if (!victim) {
+		victim = fs_mount_cur->dentries;
+		dent = victim;
+		for (i = 0; i < CONFIG_FS_CACHE_DENTRIES; i++, dent++) {
+			if (dent->age < victim->age)
+				victim = dent;
+		}
+		strcpy(victim->name, name);
+		victim->size = -1;
+	}
+
+	victim->exists = exists;
+	if (exists && size >= 0)
+		victim->size = size;
+	victim->age = ++fs_cache_age;
+}
+
+/* Forget the filesystems found on a device */
+static void fs_cache_forget_dev(int iftype, int devnum)
+{
+	struct fs_mount_cache *mnt;
+	int i;
+
+	for (i = 0, mnt = fs_mounts; i < ARRAY_SIZE(fs_mounts); i++, mnt++) {
+		if (!mnt->age || mnt->if_type != iftype ||
+		    mnt->devnum != devnum)
+			continue;
+		if (mnt == fs_mount_cur)
+			fs_mount_cur = NULL;
+		memset(mnt, '\0', sizeof(*mnt));
+	}
+}
+#else
+static inline bool fs_cache_mount(int fstype)
+{
+	return false;
+}
+
+static inline void fs_cache_add_mount(void) {}
+static inline void fs_cache_close(void) {}
+static inline void fs_cache_drop_mount(void) {}
+static inline void fs_cache_forget(void) {}
+
+static inline struct fs_dentry_cache *fs_cache_lookup(const char *name)
+{
+	return NULL;
+}
+
+static inline void fs_cache_store(const char *name, bool exists,
+				  loff_t size) {}
+static inline void fs_cache_forget_dev(int iftype, int devnum) {}
+#endif
+
+#if CONFIG_IS_ENABLED(FS_CACHE) || \
+	(IS_ENABLED(CONFIG_FS_SQUASHFS) && !defined(CONFIG_SPL_BUILD))
+void fs_cache_invalidate(int iftype, int devnum)
+{
+	fs_cache_forget_dev(iftype, devnum);
+	/* squashfs keeps the metadata of the image last used */
+	if (IS_ENABLED(CONFIG_FS_SQUASHFS))
+		sqfs_invalidate(iftype, devnum);
+}
+#endif
 
 static inline int fs_probe_unsupported(struct blk_desc *fs_dev_desc,
 				      struct disk_partition *fs_partition)
@@ -364,12 +592,61 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
-int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
+int fs_mount(void)
 {
 	struct fstype_info *info;
-	int part, i;
+
+	if (fs_probed)
+		return 0;
+
+	info = fs_get_info(fs_type);
+	if (info->probe(fs_dev_desc, &fs_partition)) {
+		fs_cache_drop_mount();
+		fs_type = FS_TYPE_ANY;
+		return -1;
+	}
+	fs_probed = true;
+
+	return 0;
+}
+
+static int fs_probe(int fstype, int part)
+{
+	struct fstype_info *info;
+	int i;
+
+	if (fs_cache_mount(fstype)) {
+		fs_dev_part = part;
+		return 0;
+	}
+
+	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
+		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
+				fstype != info->fstype)
+			continue;
+
+		if (!fs_dev_desc && !info->null_dev_desc_ok)
+			continue;
+
+		if (!info->probe(fs_dev_desc, &fs_partition)) {
+			fs_type = info->fstype;
+			fs_dev_part = part;
+			fs_probed = true;
+			fs_cache_add_mount();
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
+{
+	int part;
 #ifdef CONFIG_NEEDS_MANUAL_RELOC
+	struct fstype_info *info;
 	static int relocated;
+	int i;
 
 	if (!relocated) {
 		for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes);
@@ -390,29 +667,13 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	if (part < 0)
 		return -1;
 
-	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
-		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
-				fstype != info->fstype)
-			continue;
-
-		if (!fs_dev_desc && !info->null_dev_desc_ok)
-			continue;
-
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
-			return 0;
-		}
-	}
-
-	return -1;
+	return fs_probe(fstype, part);
 }
 
 /* set current blk device w/ blk_desc + partition # */
 int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 {
-	struct fstype_info *info;
-	int ret, i;
+	int ret;
 
 	if (part >= 1)
 		ret = part_get_info(desc, part, &fs_partition);
@@ -422,30 +683,28 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		return ret;
 	fs_dev_desc = desc;
 
-	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
-		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
-			return 0;
-		}
-	}
-
-	return -1;
+	return fs_probe(FS_TYPE_ANY, part);
 }
 
 void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	info->close();
+	if (fs_probed)
+		info->close();
 
+	fs_probed = false;
 	fs_type = FS_TYPE_ANY;
+	fs_cache_close();
 }
 
 int fs_uuid(char *uuid_str)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	if (fs_mount())
+		return -1;
+
 	return info->uuid(uuid_str);
 }
 
@@ -455,7 +714,10 @@ int fs_ls(const char *dirname)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->ls(dirname);
+	if (fs_mount())
+		ret = -1;
+	else
+		ret = info->ls(dirname);
 
 	fs_close();
 
@@ -464,11 +726,20 @@ int fs_ls(const char *dirname)
 
 int fs_exists(const char *filename)
 {
+	struct fs_dentry_cache *dent;
 	int ret;
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->exists(filename);
+	dent = fs_cache_lookup(filename);
+	if (dent) {
+		ret = dent->exists;
+	} else if (fs_mount()) {
+		ret = 0;
+	} else {
+		ret = info->exists(filename);
+		fs_cache_store(filename, ret, -1);
+	}
 
 	fs_close();
 
@@ -477,11 +748,26 @@ int fs_exists(const char *filename)
 
 int fs_size(const char *filename, loff_t *size)
 {
+	struct fs_dentry_cache *dent;
 	int ret;
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->size(filename, size);
+	/*
+	 * A negative entry only answers fs_exists(): the driver reports a
+	 * missing file with its own message and error code.
+	 */
+	dent = fs_cache_lookup(filename);
+	if (dent && dent->exists && dent->size >= 0) {
+		*size = dent->size;
+		ret = 0;
+	} else if (fs_mount()) {
+		ret = -1;
+	} else {
+		ret = info->size(filename, size);
+		if (!ret)
+			fs_cache_store(filename, true, *size);
+	}
 
 	fs_close();
 
@@ -527,9 +813,15 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 		    int do_lmb_check, loff_t *actread)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
+	ulong bounced;
 	void *buf;
 	int ret;
 
+	if (fs_mount()) {
+		fs_close();
+		return -1;
+	}
+
 #ifdef CONFIG_LMB
 	if (do_lmb_check) {
 		ret = fs_read_lmb_check(filename, addr, offset, len, info);
@@ -542,13 +834,21 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * We don't actually know how many bytes are being read, since len==0
 	 * means read the whole file.
 	 */
+	bounced = fs_get_bounced();
 	buf = map_sysmem(addr, len);
 	ret = info->read(filename, buf, offset, len, actread);
 	unmap_sysmem(buf);
+	bounced = fs_get_bounced() - bounced;
 
 	/* If we requested a specific number of bytes, check we got it */
 	if (ret == 0 && len && *actread != len)
 		log_debug("** %s shorter than offset + len **\n", filename);
+	if (ret == 0 && bounced)
+		log_debug("%s: %lu bytes copied, not read in place\n",
+			  filename, bounced);
+	/* a read of the whole file also gives its size */
+	if (ret == 0)
+		fs_cache_store(filename, true, !offset && !len ? *actread : -1);
 	fs_close();
 
 	return ret;
@@ -567,9 +867,15 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 	void *buf;
 	int ret;
 
+	if (fs_mount()) {
+		fs_close();
+		return -1;
+	}
+
 	buf = map_sysmem(addr, len);
 	ret = info->write(filename, buf, offset, len, actwrite);
 	unmap_sysmem(buf);
+	fs_cache_forget();
 
 	if (ret < 0 && len != *actwrite) {
 		log_err("** Unable to write file %s **\n", filename);
@@ -586,7 +892,10 @@ struct fs_dir_stream *fs_opendir(const char *filename)
 	struct fs_dir_stream *dirs = NULL;
 	int ret;
 
-	ret = info->opendir(filename, &dirs);
+	if (fs_mount())
+		ret = -ENODEV;
+	else
+		ret = info->opendir(filename, &dirs);
 	fs_close();
 	if (ret) {
 		errno = -ret;
@@ -608,7 +917,10 @@ struct fs_dirent *fs_readdir(struct fs_dir_stream *dirs)
 	fs_set_blk_dev_with_part(dirs->desc, dirs->part);
 	info = fs_get_info(fs_type);
 
-	ret = info->readdir(dirs, &dirent);
+	if (fs_mount())
+		ret = -ENODEV;
+	else
+		ret = info->readdir(dirs, &dirent);
 	fs_close();
 	if (ret) {
 		errno = -ret;
@@ -628,7 +940,8 @@ void fs_closedir(struct fs_dir_stream *dirs)
 	fs_set_blk_dev_with_part(dirs->desc, dirs->part);
 	info = fs_get_info(fs_type);
 
-	info->closedir(dirs);
+	if (!fs_mount())
+		info->closedir(dirs);
 	fs_close();
 }
 
@@ -638,7 +951,12 @@ int fs_unlink(const char *filename)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->unlink(filename);
+	if (fs_mount()) {
+		ret = -1;
+	} else {
+		ret = info->unlink(filename);
+		fs_cache_forget();
+	}
 
 	fs_close();
 
@@ -651,7 +969,12 @@ int fs_mkdir(const char *dirname)
 
 	struct fstype_info *info = fs_get_info(fs_type);
 
-	ret = info->mkdir(dirname);
+	if (fs_mount()) {
+		ret = -1;
+	} else {
+		ret = info->mkdir(dirname);
+		fs_cache_forget();
+	}
 
 	fs_close();
 
@@ -663,7 +986,13 @@ int fs_ln(const char *fname, const char *target)
 	struct fstype_info *info = fs_get_info(fs_type);
 	int ret;
 
+	if (fs_mount()) {
+		fs_close();
+		return -1;
+	}
+
 	ret = info->ln(fname, target);
+	fs_cache_forget();
 
 	if (ret < 0) {
 		log_err("** Unable to create link %s -> %s **\n", fname, target);
@@ -13,6 +13,54 @@
 #include <log.h>
 #include <part.h>
 #include <memalign.h>
+#include <fs_internal.h>
+
+/* Bytes which did not land in the caller's buffer straight from the device */
+static ulong fs_bounced;
+
+ulong fs_get_bounced(void)
+{
+	return fs_bounced;
+}
+
+void fs_add_bounced(ulong bytes)
+{
+	fs_bounced += bytes;
+}
+
+ulong fs_blk_dread(struct blk_desc *blk, lbaint_t start, lbaint_t blkcnt,
+		   void *buf)
+{
+	ulong misalign = (ulong)buf & (ARCH_DMA_MINALIGN - 1);
+	ALLOC_CACHE_ALIGN_BUFFER(char, sec_buf, blk->blksz);
+	char *dst = buf;
+	lbaint_t n;
+
+	if (!misalign || !blkcnt)
+		return blk_dread(blk, start, blkcnt, buf);
+
+	/*
+	 * Read all but the last block to the first aligned address inside
+	 * @buf, which still fits as the shift is smaller than a block, then
+	 * move the data down. Only the last block goes through a bounce buffer.
+	 */
+	n = blkcnt - 1;
+	if (n) {
+		char *aligned = dst + ARCH_DMA_MINALIGN - misalign;
+
+		if (blk_dread(blk, start, n, aligned) != n)
+			return 0;
+		memmove(dst, aligned, n * blk->blksz);
+		fs_bounced += n * blk->blksz;
+	}
+
+	if (blk_dread(blk, start + n, 1, sec_buf) != 1)
+		return n;
+	memcpy(dst + n * blk->blksz, sec_buf, blk->blksz);
+	fs_bounced += blk->blksz;
+
+	return blkcnt;
+}
 
 int fs_devread(struct blk_desc *blk, struct disk_partition *partition,
 	       lbaint_t sector, int byte_offset, int byte_len, char *buf)
@@ -51,6 +99,7 @@ int fs_devread(struct blk_desc *blk, struct disk_partition *partition,
 		readlen = min((int)blk->blksz - byte_offset,
 			      byte_len);
 		memcpy(buf, sec_buf + byte_offset, readlen);
+		fs_bounced += readlen;
 		buf += readlen;
 		byte_len -= readlen;
 		sector++;
@@ -69,11 +118,12 @@ int fs_devread(struct blk_desc *blk, struct disk_partition *partition,
 		blk_dread(blk, partition->start + sector, 1,
 			  (void *)p);
 		memcpy(buf, p, byte_len);
+		fs_bounced += byte_len;
 		return 1;
 	}
 
-	if (blk_dread(blk, partition->start + sector,
-		      block_len >> log2blksz, (void *)buf) !=
+	if (fs_blk_dread(blk, partition->start + sector,
+			 block_len >> log2blksz, (void *)buf) !=
 			block_len >> log2blksz) {
 		log_err(" ** %s read error - block\n", __func__);
 		return 0;
@@ -91,6 +141,7 @@ int fs_devread(struct blk_desc *blk, struct disk_partition *partition,
 			return 0;
 		}
 		memcpy(buf, sec_buf, byte_len);
+		fs_bounced += byte_len;
 	}
 	return 1;
 }
@@ -100,36 +100,36 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 			    struct squashfs_fragment_block_entry *e)
 {
 	u64 start, n_blks, src_len, table_offset, start_block;
-	unsigned char *metadata_buffer, *metadata, *table;
-	struct squashfs_fragment_block_entry *entries;
+	struct squashfs_cache *cache = &ctxt.cache;
 	struct squashfs_super_block *sblk = ctxt.sblk;
+	unsigned char *metadata_buffer, *metadata;
 	unsigned long dest_len;
 	int block, offset, ret;
 	u16 header;
 
 	metadata_buffer = NULL;
-	entries = NULL;
-	table = NULL;
 
 	if (inode_fragment_index >= get_unaligned_le32(&sblk->fragments))
 		return -EINVAL;
 
-	start = get_unaligned_le64(&sblk->fragment_table_start) /
-		ctxt.cur_dev->blksz;
-	n_blks = sqfs_calc_n_blks(sblk->fragment_table_start,
-				  sblk->export_table_start,
-				  &table_offset);
-
-	/* Allocate a proper sized buffer to store the fragment index table */
-	table = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-	if (!table) {
-		ret = -ENOMEM;
-		goto out;
-	}
-
-	if (sqfs_disk_read(start, n_blks, table) < 0) {
-		ret = -EINVAL;
-		goto out;
+	/* The fragment index table is read once for each image */
+	if (!cache->frag_table) {
+		start = get_unaligned_le64(&sblk->fragment_table_start) /
+			ctxt.cur_dev->blksz;
+		n_blks = sqfs_calc_n_blks(sblk->fragment_table_start,
+					  sblk->export_table_start,
+					  &cache->frag_table_offset);
+
+		cache->frag_table = malloc_cache_aligned(n_blks *
+							 ctxt.cur_dev->blksz);
+		if (!cache->frag_table)
+			return -ENOMEM;
+
+		if (sqfs_disk_read(start, n_blks, cache->frag_table) < 0) {
+			free(cache->frag_table);
+			cache->frag_table = NULL;
+			return -EINVAL;
+		}
 	}
 
 	block = SQFS_FRAGMENT_INDEX(inode_fragment_index);
@@ -139,8 +139,12 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 	 * Get the start offset of the metadata block that contains the right
 	 * fragment block entry
 	 */
-	start_block = get_unaligned_le64(table + table_offset + block *
-					 sizeof(u64));
+	start_block = get_unaligned_le64(cache->frag_table +
+					 cache->frag_table_offset +
+					 block * sizeof(u64));
+
+	if (cache->frag_entries && cache->frag_entries_start == start_block)
+		goto found;
 
 	start = start_block / ctxt.cur_dev->blksz;
 	n_blks = sqfs_calc_n_blks(cpu_to_le64(start_block),
@@ -166,32 +170,37 @@ static int sqfs_frag_lookup(u32 inode_fragment_index,
 		goto out;
 	}
 
-	entries = malloc(SQFS_METADATA_BLOCK_SIZE);
-	if (!entries) {
-		ret = -ENOMEM;
-		goto out;
+	if (!cache->frag_entries) {
+		cache->frag_entries = malloc(SQFS_METADATA_BLOCK_SIZE);
+		if (!cache->frag_entries) {
+			ret = -ENOMEM;
+			goto out;
+		}
 	}
 
 	if (SQFS_COMPRESSED_METADATA(header)) {
 		src_len = SQFS_METADATA_SIZE(header);
 		dest_len = SQFS_METADATA_BLOCK_SIZE;
-		ret = sqfs_decompress(&ctxt, entries, &dest_len, metadata,
-				      src_len);
+		ret = sqfs_decompress(&ctxt, cache->frag_entries, &dest_len,
+				      metadata, src_len);
 		if (ret) {
+			free(cache->frag_entries);
+			cache->frag_entries = NULL;
 			ret = -EINVAL;
 			goto out;
 		}
 	} else {
-		memcpy(entries, metadata, SQFS_METADATA_SIZE(header));
+		memcpy(cache->frag_entries, metadata,
+		       SQFS_METADATA_SIZE(header));
 	}
+	cache->frag_entries_start = start_block;
 
-	*e = entries[offset];
+found:
+	*e = cache->frag_entries[offset];
 	ret = SQFS_COMPRESSED_BLOCK(e->size);
 
 out:
-	free(entries);
 	free(metadata_buffer);
-	free(table);
 
 	return ret;
 }
@@ -868,13 +877,100 @@ out:
 	return metablks_count;
 }
 
+/*
+ * Decompress the inode and directory tables into the metadata cache, unless
+ * they are already there.
+ */
+static int sqfs_get_tables(void)
+{
+	struct squashfs_cache *cache = &ctxt.cache;
+	struct squashfs_tables *tables;
+	int ret;
+
+	if (cache->tables)
+		return 0;
+
+	tables = calloc(1, sizeof(*tables));
+	if (!tables)
+		return -ENOMEM;
+
+	ret = sqfs_read_inode_table(&tables->inode_table);
+	if (ret) {
+		free(tables);
+		return ret;
+	}
+
+	tables->dir_metablks = sqfs_read_directory_table(&tables->dir_table,
+							 &tables->pos_list);
+	if (tables->dir_metablks < 1) {
+		free(tables->inode_table);
+		free(tables);
+		return -EINVAL;
+	}
+
+	tables->refs = 1;
+	cache->tables = tables;
+
+	return 0;
+}
+
+/* Drop a reference to the tables, freeing them with the last one */
+static void sqfs_put_tables(struct squashfs_tables *tables)
+{
+	if (!tables || --tables->refs)
+		return;
+
+	free(tables->inode_table);
+	free(tables->dir_table);
+	free(tables->pos_list);
+	free(tables);
+}
+
+static void sqfs_cache_free(void)
+{
+	struct squashfs_cache *cache = &ctxt.cache;
+
+	/* Open directory streams keep their own reference to the tables */
+	sqfs_put_tables(cache->tables);
+	free(cache->frag_table);
+	free(cache->frag_entries);
+	free(cache->frag_block);
+	memset(cache, 0, sizeof(*cache));
+}
+
+/* Drop the metadata cache if it belongs to another image */
+static void sqfs_cache_check(void)
+{
+	struct squashfs_cache *cache = &ctxt.cache;
+
+	if (cache->dev == ctxt.cur_dev &&
+	    cache->part_start == ctxt.cur_part_info.start &&
+	    !memcmp(&cache->sblk, ctxt.sblk, sizeof(cache->sblk)))
+		return;
+
+	sqfs_cache_free();
+	cache->dev = ctxt.cur_dev;
+	cache->if_type = ctxt.cur_dev->if_type;
+	cache->devnum = ctxt.cur_dev->devnum;
+	cache->part_start = ctxt.cur_part_info.start;
+	memcpy(&cache->sblk, ctxt.sblk, sizeof(cache->sblk));
+}
+
+void sqfs_invalidate(int if_type, int devnum)
+{
+	struct squashfs_cache *cache = &ctxt.cache;
+
+	/* The device may be gone, so only its type and number are compared */
+	if (cache->dev && cache->if_type == if_type &&
+	    cache->devnum == devnum)
+		sqfs_cache_free();
+}
+
 int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 {
-	unsigned char *inode_table = NULL, *dir_table = NULL;
-	int j, token_count = 0, ret = 0, metablks_count;
+	int j, token_count = 0, ret = 0;
 	struct squashfs_dir_stream *dirs;
 	char **token_list = NULL, *path = NULL;
-	u32 *pos_list = NULL;
 
 	dirs = calloc(1, sizeof(*dirs));
 	if (!dirs)
@@ -887,18 +983,12 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	dirs->inode_table = NULL;
 	dirs->dir_table = NULL;
 
-	ret = sqfs_read_inode_table(&inode_table);
+	ret = sqfs_get_tables();
 	if (ret) {
 		ret = -EINVAL;
 		goto out;
 	}
 
-	metablks_count = sqfs_read_directory_table(&dir_table, &pos_list);
-	if (metablks_count < 1) {
-		ret = -EINVAL;
-		goto out;
-	}
-
 	/* Tokenize filename */
 	token_count = sqfs_count_tokens(filename);
 	if (token_count < 0) {
@@ -926,10 +1016,13 @@ int sqfs_opendir(const char *filename, struct fs_dir_stream **dirsp)
 	 * ldir's (extended directory) size is greater than dir, so it works as
 	 * a general solution for the malloc size, since 'i' is a union.
 	 */
-	dirs->inode_table = inode_table;
-	dirs->dir_table = dir_table;
-	ret = sqfs_search_dir(dirs, token_list, token_count, pos_list,
-			      metablks_count);
+	dirs->tables = ctxt.cache.tables;
+	dirs->tables->refs++;
+	dirs->inode_table = dirs->tables->inode_table;
+	dirs->dir_table = dirs->tables->dir_table;
+	ret = sqfs_search_dir(dirs, token_list, token_count,
+			      dirs->tables->pos_list,
+			      dirs->tables->dir_metablks);
 	if (ret)
 		goto out;
 
@@ -953,10 +1046,9 @@ out:
 	for (j = 0; j < token_count; j++)
 		free(token_list[j]);
 	free(token_list);
-	free(pos_list);
 	free(path);
 	if (ret) {
-		free(inode_table);
+		sqfs_put_tables(dirs->tables);
 		free(dirs);
 	}
 
@@ -1096,6 +1188,7 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 	}
 
 	ctxt.sblk = sblk;
+	sqfs_cache_check();
 
 	ret = sqfs_decompressor_init(&ctxt);
 	if (ret) {
@@ -1305,13 +1398,178 @@ static int sqfs_get_lregfile_info(struct squashfs_lreg_inode *lreg,
 	return datablk_count;
 }
 
+/*
+ * A buffer of consecutive data blocks read from the disk. With a device which
+ * can queue requests, the next batch is read into a second buffer while the
+ * current one is decompressed.
+ */
+struct sqfs_batch {
+	void *buf;
+	u64 start;	/* image offset of the first byte of @buf */
+	u64 end;	/* image offset after the last complete block read */
+	int next;	/* index of the first data block after the batch */
+	bool pending;	/* read submitted but not waited for yet */
+#if CONFIG_IS_ENABLED(BLK)
+	struct blk_req req;
+#endif
+};
+
+/*
+ * Read data blocks of a file starting with block @first, which begins at byte
+ * @data_offset of the image. Consecutive blocks are stored one after the
+ * other, so as many of them as fit in @batch (@batch_size bytes) are read with
+ * a single disk access, stopping after the block which reaches @len bytes of
+ * file data. If @async is set the read is only submitted, and
+ * sqfs_batch_wait() must be called before the data is used.
+ */
+static int sqfs_read_batch(struct squashfs_file_info *finfo, int first,
+			   int count, u64 data_offset, loff_t len,
+			   struct sqfs_batch *batch, u64 batch_size,
+			   bool async)
+{
+	u32 blksz = ctxt.cur_dev->blksz;
+	u32 block_size = get_unaligned_le32(&ctxt.sblk->block_size);
+	u64 start, table_offset, run = 0, n_blks;
+	int j;
+
+	start = data_offset / blksz;
+	table_offset = data_offset - start * blksz;
+
+	for (j = first; j < count; j++) {
+		u32 size = SQFS_BLOCK_SIZE(finfo->blk_sizes[j]);
+
+		if (j > first && table_offset + run + size > batch_size)
+			break;
+		run += size;
+		if ((u64)(j + 1) * block_size >= len) {
+			j++;
+			break;
+		}
+	}
+
+	n_blks = DIV_ROUND_UP(table_offset + run, blksz);
+	batch->start = start * blksz;
+	batch->end = data_offset + run;
+	batch->next = j;
+
+#if CONFIG_IS_ENABLED(BLK)
+	if (async) {
+		memset(&batch->req, '\0', sizeof(batch->req));
+		batch->req.start = ctxt.cur_part_info.start + start;
+		batch->req.blkcnt = n_blks;
+		batch->req.buffer = batch->buf;
+		if (blk_submit(ctxt.cur_dev, &batch->req)) {
+			batch->start = 0;
+			batch->end = 0;
+			return -EIO;
+		}
+		batch->pending = true;
+
+		return 0;
+	}
+#endif
+	if (sqfs_disk_read(start, n_blks, batch->buf) < 0)
+		return -EIO;
+
+	return 0;
+}
+
+/* Wait for the read submitted by sqfs_read_batch(), if any */
+static int sqfs_batch_wait(struct sqfs_batch *batch)
+{
+#if CONFIG_IS_ENABLED(BLK)
+	long n;
+
+	if (!batch->pending)
+		return 0;
+	batch->pending = false;
+	n = blk_wait(ctxt.cur_dev, &batch->req);
+	if (n != batch->req.blkcnt) {
+		/* don't use what may be in the buffer */
+		batch->start = 0;
+		batch->end = 0;
+		return -EIO;
+	}
+#endif
+
+	return 0;
+}
+
+/*
+ * Return the uncompressed fragment block described by @e, reading it unless it
+ * is the one kept in the metadata cache.
+ */
+static int sqfs_get_fragment(struct squashfs_fragment_block_entry *e,
+			     bool comp, unsigned char **blockp)
+{
+	struct squashfs_cache *cache = &ctxt.cache;
+	u64 start, n_blks, table_size, table_offset;
+	unsigned char *fragment;
+	unsigned long dest_len;
+	int ret = 0;
+
+	if (cache->frag_block && cache->frag_start == e->start) {
+		*blockp = cache->frag_block;
+		return 0;
+	}
+
+	dest_len = get_unaligned_le32(&ctxt.sblk->block_size);
+	if (!cache->frag_block) {
+		cache->frag_block = malloc(dest_len);
+		if (!cache->frag_block)
+			return -ENOMEM;
+	}
+
+	start = e->start / ctxt.cur_dev->blksz;
+	table_size = SQFS_BLOCK_SIZE(e->size);
+	table_offset = e->start - (start * ctxt.cur_dev->blksz);
+	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
+
+	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
+	if (!fragment)
+		return -ENOMEM;
+
+	ret = sqfs_disk_read(start, n_blks, fragment);
+	if (ret < 0)
+		goto out;
+
+	if (comp) {
+		ret = sqfs_decompress(&ctxt, cache->frag_block, &dest_len,
+				      fragment + table_offset, e->size);
+		if (ret)
+			goto out;
+	} else {
+		if (table_size > dest_len) {
+			ret = -EINVAL;
+			goto out;
+		}
+		memcpy(cache->frag_block, fragment + table_offset, table_size);
+	}
+
+	cache->frag_start = e->start;
+	*blockp = cache->frag_block;
+	ret = 0;
+
+out:
+	if (ret) {
+		free(cache->frag_block);
+		cache->frag_block = NULL;
+	}
+	free(fragment);
+
+	return ret;
+}
+
 int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 	      loff_t *actread)
 {
-	char *dir = NULL, *fragment_block, *datablock = NULL, *data_buffer = NULL;
-	char *fragment = NULL, *file = NULL, *resolved, *data;
-	u64 start, n_blks, table_size, data_offset, table_offset, sparse_size;
+	char *dir = NULL, *datablock = NULL;
+	char *file = NULL, *resolved, *data;
+	u64 table_size, data_offset, sparse_size, batch_size;
+	struct sqfs_batch batches[2] = { 0 };
+	struct sqfs_batch *cur = &batches[0], *next = &batches[1];
 	int ret, j, i_number, datablk_count = 0;
+	unsigned char *fragment_block;
 	struct squashfs_super_block *sblk = ctxt.sblk;
 	struct squashfs_fragment_block_entry frag_entry;
 	struct squashfs_file_info finfo = {0};
@@ -1435,41 +1693,72 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 			ret = -ENOMEM;
 			goto out;
 		}
+
+		/* Room for a whole data block plus its offset in a sector */
+		batch_size = max_t(u64, SQFS_READ_BATCH_SIZE,
+				   get_unaligned_le32(&sblk->block_size)) +
+			     ctxt.cur_dev->blksz;
+		cur->buf = malloc_cache_aligned(batch_size);
+		if (!cur->buf) {
+			ret = -ENOMEM;
+			goto out;
+		}
+#if CONFIG_IS_ENABLED(BLK)
+		/*
+		 * One batch can be read while the previous one is decompressed
+		 * if the device returns from blk_submit() before the transfer
+		 * is done. Otherwise batches are read one after the other.
+		 */
+		if (datablk_count > 1 && blk_is_async(ctxt.cur_dev))
+			next->buf = malloc_cache_aligned(batch_size);
+#endif
 	}
 
 	for (j = 0; j < datablk_count; j++) {
-		start = data_offset / ctxt.cur_dev->blksz;
 		table_size = SQFS_BLOCK_SIZE(finfo.blk_sizes[j]);
-		table_offset = data_offset - (start * ctxt.cur_dev->blksz);
-		n_blks = DIV_ROUND_UP(table_size + table_offset,
-				      ctxt.cur_dev->blksz);
 
 		/* Don't load any data for sparse blocks */
 		if (finfo.blk_sizes[j] == 0) {
-			n_blks = 0;
-			table_offset = 0;
-			data_buffer = NULL;
 			data = NULL;
 		} else {
-			data_buffer = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-			if (!data_buffer) {
-				ret = -ENOMEM;
-				goto out;
+			if (data_offset < cur->start ||
+			    data_offset + table_size > cur->end) {
+				/* A failed read-ahead is simply read again */
+				sqfs_batch_wait(next);
+				if (data_offset >= next->start &&
+				    data_offset + table_size <= next->end) {
+					swap(cur, next);
+					ret = 0;
+				} else {
+					ret = sqfs_read_batch(&finfo, j,
+							      datablk_count,
+							      data_offset, len,
+							      cur, batch_size,
+							      false);
+				}
+				if (ret < 0) {
+					/*
+					 * Possible causes: too many data
+					 * blocks or too large SquashFS block
+					 * size. Tip: re-compile the SquashFS
+					 * image with mksquashfs's
+					 * -b <block_size> option.
+					 */
+					printf("Error: too many data blocks to be read.\n");
+					goto out;
+				}
+
+				/* Read ahead while this batch is decompressed */
+				if (next->buf && cur->next < datablk_count &&
+				    (u64)cur->next * get_unaligned_le32(
+						&sblk->block_size) < len)
+					sqfs_read_batch(&finfo, cur->next,
+							datablk_count, cur->end,
+							len, next, batch_size,
+							true);
 			}
 
-			ret = sqfs_disk_read(start, n_blks, data_buffer);
-			if (ret < 0) {
-				/*
-				 * Possible causes: too many data blocks or too large
-				 * SquashFS block size. Tip: re-compile the SquashFS
-				 * image with mksquashfs's -b <block_size> option.
-				 */
-				printf("Error: too many data blocks to be read.\n");
-				goto out;
-			}
-
-			data = data_buffer + table_offset;
+			data = cur->buf + (data_offset - cur->start);
 		}
 
 		/* Load the data */
@@ -1482,15 +1771,30 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 			*actread += sparse_size;
 		} else if (SQFS_COMPRESSED_BLOCK(finfo.blk_sizes[j])) {
 			dest_len = get_unaligned_le32(&sblk->block_size);
-			ret = sqfs_decompress(&ctxt, datablock, &dest_len,
-					      data, table_size);
-			if (ret)
-				goto out;
-
-			if ((*actread + dest_len) > len)
-				dest_len = len - *actread;
-			memcpy(buf + *actread, datablock, dest_len);
-			*actread += dest_len;
+			/*
+			 * Decompress whole blocks straight into the caller's
+			 * buffer; only a partial last block needs a copy.
+			 */
+			if (len - *actread >= dest_len) {
+				ret = sqfs_decompress(&ctxt, buf + *actread,
+						      &dest_len, data,
+						      table_size);
+				if (ret)
+					goto out;
+
+				*actread += dest_len;
+			} else {
+				ret = sqfs_decompress(&ctxt, datablock,
+						      &dest_len, data,
+						      table_size);
+				if (ret)
+					goto out;
+
+				if ((*actread + dest_len) > len)
+					dest_len = len - *actread;
+				memcpy(buf + *actread, datablock, dest_len);
+				*actread += dest_len;
+			}
 		} else {
 			if ((*actread + table_size) > len)
 				table_size = len - *actread;
@@ -1499,9 +1803,6 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 		}
 
 		data_offset += table_size;
-		if (data_buffer)
-			free(data_buffer);
-		data_buffer = NULL;
 		if (*actread >= len)
 			break;
 	}
@@ -1514,55 +1815,20 @@ int sqfs_read(const char *filename, void *buf, loff_t offset, loff_t len,
 		goto out;
 	}
 
-	start = frag_entry.start / ctxt.cur_dev->blksz;
-	table_size = SQFS_BLOCK_SIZE(frag_entry.size);
-	table_offset = frag_entry.start - (start * ctxt.cur_dev->blksz);
-	n_blks = DIV_ROUND_UP(table_size + table_offset, ctxt.cur_dev->blksz);
-
-	fragment = malloc_cache_aligned(n_blks * ctxt.cur_dev->blksz);
-
-	if (!fragment) {
-		ret = -ENOMEM;
-		goto out;
-	}
-
-	ret = sqfs_disk_read(start, n_blks, fragment);
-	if (ret < 0)
+	ret = sqfs_get_fragment(&frag_entry, finfo.comp, &fragment_block);
+	if (ret)
 		goto out;
 
-	/* File compressed and fragmented */
-	if (finfo.frag && finfo.comp) {
-		dest_len = get_unaligned_le32(&sblk->block_size);
-		fragment_block = malloc(dest_len);
-		if (!fragment_block) {
-			ret = -ENOMEM;
-			goto out;
-		}
-
-		ret = sqfs_decompress(&ctxt, fragment_block, &dest_len,
-				      (void *)fragment  + table_offset,
-				      frag_entry.size);
-		if (ret) {
-			free(fragment_block);
-			goto out;
-		}
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-
-		free(fragment_block);
-
-	} else if (finfo.frag && !finfo.comp) {
-		fragment_block = (void *)fragment + table_offset;
-
-		memcpy(buf + *actread, &fragment_block[finfo.offset], finfo.size - *actread);
-		*actread = finfo.size;
-	}
+	memcpy(buf + *actread, &fragment_block[finfo.offset],
+	       finfo.size - *actread);
+	*actread = finfo.size;
 
 out:
-	free(fragment);
 	if (datablk_count) {
-		free(data_buffer);
+		/* The device may still be writing into the read-ahead buffer */
+		sqfs_batch_wait(next);
+		free(batches[0].buf);
+		free(batches[1].buf);
 		free(datablock);
 	}
 	free(file);
@@ -1716,8 +1982,7 @@ void sqfs_closedir(struct fs_dir_stream *dirs)
 		return;
 
 	sqfs_dirs = (struct squashfs_dir_stream *)dirs;
-	free(sqfs_dirs->inode_table);
-	free(sqfs_dirs->dir_table);
+	sqfs_put_tables(sqfs_dirs->tables);
 	free(sqfs_dirs->dir_header);
 	free(sqfs_dirs);
 }
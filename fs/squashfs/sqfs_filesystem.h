@@ -19,6 +19,8 @@
 #define SQFS_DIR_INDEX_BASE_LENGTH 12
 /* size of metadata (inode and directory) blocks */
 #define SQFS_METADATA_BLOCK_SIZE 8192
+/* Data blocks read from the disk at once by sqfs_read() */
+#define SQFS_READ_BATCH_SIZE (1024 * 1024)
 /* Max. number of fragment entries in a metadata block is 512 */
 #define SQFS_MAX_ENTRIES 512
 /* Metadata blocks start by a 2-byte length header */
@@ -73,10 +75,49 @@ struct squashfs_super_block {
 	__le64 export_table_start;
 };
 
+/*
+ * Inode and directory tables of an image, see sqfs_get_tables(). They are
+ * shared by the metadata cache and the open directory streams, each holding
+ * a reference, and freed when the last reference is dropped.
+ */
+struct squashfs_tables {
+	int refs;
+	unsigned char *inode_table;
+	unsigned char *dir_table;
+	u32 *pos_list;
+	int dir_metablks;
+};
+
+/*
+ * Decompressed metadata of the image last probed. It is kept by sqfs_close()
+ * and reused for as long as the same superblock is found on the same
+ * partition, so that loading several files from an image only reads and
+ * decompresses its tables once. Only one image is cached at a time, and the
+ * cache is dropped by sqfs_invalidate() when its device changes.
+ */
+struct squashfs_cache {
+	struct blk_desc *dev;
+	int if_type;
+	int devnum;
+	lbaint_t part_start;
+	struct squashfs_super_block sblk;
+	struct squashfs_tables *tables;
+	/* Fragment index table, as read from the disk */
+	unsigned char *frag_table;
+	u64 frag_table_offset;
+	/* Last metadata block of fragment entries and its position */
+	struct squashfs_fragment_block_entry *frag_entries;
+	u64 frag_entries_start;
+	/* Last fragment block, uncompressed, and its position */
+	unsigned char *frag_block;
+	u64 frag_start;
+};
+
 struct squashfs_ctxt {
 	struct disk_partition cur_part_info;
 	struct blk_desc *cur_dev;
 	struct squashfs_super_block *sblk;
+	struct squashfs_cache cache;
 #if IS_ENABLED(CONFIG_ZSTD)
 	void *zstd_workspace;
 #endif
@@ -274,8 +315,10 @@ struct squashfs_dir_stream {
 	struct squashfs_ldir_inode i_ldir;
 	/*
 	 * References to the tables' beginnings. They are assigned in
-	 * sqfs_opendir() and freed in sqfs_closedir().
+	 * sqfs_opendir() and point into 'tables', which the stream holds a
+	 * reference to until sqfs_closedir().
 	 */
+	struct squashfs_tables *tables;
 	unsigned char *inode_table;
 	unsigned char *dir_table;
 };
@@ -158,6 +158,27 @@ void blkcache_fill(int iftype, int dev,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer);
 
+/**
+ * blkcache_readahead() - widen a read which missed the cache
+ *
+ * Small reads are rounded out to whole cache lines so they can be cached,
+ * and a read which continues a sequential stream is extended to fetch the
+ * blocks which follow it as well. The caller should read the returned number
+ * of blocks starting at @rastart into @rabuf, pass them to blkcache_fill()
+ * and copy out the blocks it asked for.
+ *
+ * @param desc - block device being read
+ * @param start - starting block number requested
+ * @param blkcnt - number of blocks requested
+ * @param rastart - returns the starting block number to read
+ * @param rabuf - returns the buffer to read into
+ *
+ * @return - number of blocks to read, or 0 to read the requested blocks
+ * directly into the caller's buffer
+ */
+lbaint_t blkcache_readahead(struct blk_desc *desc, lbaint_t start,
+			    lbaint_t blkcnt, lbaint_t *rastart, void **rabuf);
+
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
@@ -170,8 +191,11 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * This drops everything in the cache. Each device cache is re-created on its
+ * next use with the new geometry.
+ *
+ * @param blocks - blocks per entry (cache line)
+ * @param entries - entries in the cache of each device
  */
 void blkcache_configure(unsigned blocks, unsigned entries);
 
@@ -181,9 +205,11 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
+	unsigned readaheads; /* reads extended for a sequential stream */
 	unsigned entries; /* current entry count */
 	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	unsigned max_entries; /* default entry count for each device */
+	unsigned ways; /* entries in each set */
 };
 
 /**
@@ -206,6 +232,13 @@ static inline void blkcache_fill(int iftype, int dev,
 				 lbaint_t start, lbaint_t blkcnt,
 				 unsigned long blksz, void const *buffer) {}
 
+static inline lbaint_t blkcache_readahead(struct blk_desc *desc,
+					  lbaint_t start, lbaint_t blkcnt,
+					  lbaint_t *rastart, void **rabuf)
+{
+	return 0;
+}
+
 static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
@@ -213,6 +246,31 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 #if CONFIG_IS_ENABLED(BLK)
 struct udevice;
 
+/**
+ * struct blk_req - an asynchronous block request
+ *
+ * The caller fills in @start, @blkcnt, @buffer and @write, then passes the
+ * request to blk_submit(). The request (and the buffer) must stay valid until
+ * blk_poll() reports that it is done.
+ *
+ * @start:	Start block number
+ * @blkcnt:	Number of blocks to transfer
+ * @buffer:	Data buffer (destination for reads, source for writes)
+ * @write:	true to write, false to read
+ * @done:	Set when the request has completed
+ * @result:	Number of blocks transferred, or -ve error number, once @done
+ * @priv:	Private data for the driver handling the request
+ */
+struct blk_req {
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	bool write;
+	bool done;
+	long result;
+	void *priv;
+};
+
 /* Operations on block devices */
 struct blk_ops {
 	/**
@@ -271,6 +329,41 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+	/**
+	 * submit() - start an asynchronous request (optional)
+	 *
+	 * The driver starts the transfer and returns without waiting for it.
+	 * Completion is reported through poll(). Drivers which do not
+	 * implement this are handled synchronously by blk_submit().
+	 *
+	 * @dev:	Device to access
+	 * @req:	Request to start
+	 * @return 0 if started, -EBUSY if the device cannot accept another
+	 * request yet, other -ve error on failure
+	 */
+	int (*submit)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * poll() - check for completion of an asynchronous request
+	 *
+	 * This must not block. It may be used by the driver to make further
+	 * progress on the request, e.g. to issue its next command. When the
+	 * request has finished the driver sets req->result and req->done.
+	 *
+	 * @dev:	Device to check
+	 * @req:	Request previously passed to submit()
+	 * @return 0 if OK (whether or not the request is done), -ve on error
+	 */
+	int (*poll)(struct udevice *dev, struct blk_req *req);
+
+	/**
+	 * get_queue_depth() - get the number of requests the device can take
+	 *
+	 * @dev:	Device to check
+	 * @return maximum number of requests which may be outstanding at once
+	 */
+	int (*get_queue_depth)(struct udevice *dev);
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
@@ -288,6 +381,59 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt);
 
+/**
+ * blk_submit() - start an asynchronous block request
+ *
+ * If the driver does not support asynchronous requests the transfer is
+ * performed immediately and the request is already done on return.
+ *
+ * @block_dev:	Block device to access
+ * @req:	Request to start (see struct blk_req)
+ * @return 0 if OK, -EBUSY if the device is busy (try again after polling
+ * outstanding requests), other -ve on error
+ */
+int blk_submit(struct blk_desc *block_dev, struct blk_req *req);
+
+/**
+ * blk_poll() - check whether an asynchronous block request is complete
+ *
+ * @block_dev:	Block device the request was submitted to
+ * @req:	Request to check
+ * @return 0 if the request is done, -EBUSY if still in progress, other -ve
+ * on error
+ */
+int blk_poll(struct blk_desc *block_dev, struct blk_req *req);
+
+/**
+ * blk_wait() - wait for an asynchronous block request to complete
+ *
+ * @block_dev:	Block device the request was submitted to
+ * @req:	Request to wait for
+ * @return number of blocks transferred, or -ve error number
+ */
+long blk_wait(struct blk_desc *block_dev, struct blk_req *req);
+
+/**
+ * blk_get_queue_depth() - get the number of requests a device can queue
+ *
+ * @block_dev:	Block device to check
+ * @return number of requests which may be outstanding at once (1 if the
+ * device does not support asynchronous requests)
+ */
+int blk_get_queue_depth(struct blk_desc *block_dev);
+
+/**
+ * blk_is_async() - check whether a device handles requests in the background
+ *
+ * If so, blk_submit() returns before the transfer is done, so the caller can
+ * get on with other work, e.g. decompressing the previous buffer, until
+ * blk_poll() reports it complete. This holds even with a queue depth of 1.
+ *
+ * @block_dev:	Block device to check
+ * @return true if the driver implements submit() and poll()
+ */
+bool blk_is_async(struct blk_desc *block_dev);
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -701,6 +847,31 @@ const char *blk_get_if_type_name(enum if_type if_type);
 int blk_common_cmd(int argc, char *const argv[], enum if_type if_type,
 		   int *cur_devnump);
 
+/**
+ * blk_bench() - measure the performance of a block device
+ *
+ * This runs sequential and random transfers of sizes from 4KiB up to
+ * @max_size and prints the throughput, IOPS and latencies of each.
+ *
+ * @desc: Block device to use
+ * @addr: Address of a buffer of @max_size bytes
+ * @max_size: Largest transfer size, a multiple of the block size
+ * @write: true to write (destroying the contents of the device), false to
+ *	read
+ * @return 0 if OK, -ve on error
+ */
+int blk_bench(struct blk_desc *desc, ulong addr, ulong max_size, bool write);
+
+/**
+ * blk_bench_cmd() - handle the arguments of a benchmark command
+ *
+ * @desc: Block device to use
+ * @argc: Number of arguments, without the command and device
+ * @argv: Arguments: <addr> [<max_size> [read|write]]
+ * @return CMD_RET_SUCCESS if OK, other CMD_RET_... on error
+ */
+int blk_bench_cmd(struct blk_desc *desc, int argc, char *const argv[]);
+
 enum blk_flag_t {
 	BLKF_FIXED	= 1 << 0,
 	BLKF_REMOVABLE	= 1 << 1,
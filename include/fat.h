@@ -25,7 +25,11 @@ struct disk_partition;
 #define DIRENTSPERCLUST	((mydata->clust_size * mydata->sect_size) / \
 			 sizeof(dir_entry))
 
-#define FATBUFBLOCKS	6
+/*
+ * Number of sectors of the FAT held in fatbuf. This must be a multiple of 3
+ * so that FAT12 entries do not straddle two buffers.
+ */
+#define FATBUFBLOCKS	CONFIG_VAL(FS_FAT_BUF_SECTORS)
 #define FATBUFSIZE	(mydata->sect_size * FATBUFBLOCKS)
 #define FAT12BUFSIZE	((FATBUFSIZE*2)/3)
 #define FAT16BUFSIZE	(FATBUFSIZE/2)
@@ -66,6 +66,35 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype);
  */
 int fs_set_blk_dev_with_part(struct blk_desc *desc, int part);
 
+/**
+ * fs_mount() - Make sure the current filesystem is ready for use
+ *
+ * When the filesystem type of a partition is known from the mount cache,
+ * fs_set_blk_dev() and fs_set_blk_dev_with_part() do not probe it. The
+ * fs_*() functions call this before accessing the filesystem; code which
+ * calls filesystem-specific functions directly must call it first.
+ *
+ * Return: 0 on success, -1 if the filesystem could not be probed
+ */
+int fs_mount(void);
+
+/**
+ * fs_cache_invalidate() - Forget cached filesystems on a block device
+ *
+ * Called by blkcache_invalidate() when a device is written, reinitialised or
+ * removed, so that the next access probes the filesystem and looks up paths
+ * again. This also drops the squashfs metadata of an image on the device.
+ *
+ * @iftype:	IF_TYPE_x for type of device
+ * @devnum:	device index of particular type
+ */
+#if CONFIG_IS_ENABLED(FS_CACHE) || \
+	(IS_ENABLED(CONFIG_FS_SQUASHFS) && !defined(CONFIG_SPL_BUILD))
+void fs_cache_invalidate(int iftype, int devnum);
+#else
+static inline void fs_cache_invalidate(int iftype, int devnum) {}
+#endif
+
 /**
  * fs_close() - Unset current block device and partition
  *
@@ -13,4 +13,35 @@
 int fs_devread(struct blk_desc *, struct disk_partition *, lbaint_t, int, int,
 	       char *);
 
+/**
+ * fs_blk_dread() - read whole blocks into a buffer of any alignment
+ *
+ * Like blk_dread(), but when @buf is not aligned for DMA the blocks are still
+ * transferred by the device in one request to an aligned address inside @buf
+ * and moved into place, with only the last block bounced.
+ *
+ * @blk:	block device to read from
+ * @start:	first block to read
+ * @blkcnt:	number of blocks to read
+ * @buf:	destination buffer
+ * Return:	number of blocks read
+ */
+ulong fs_blk_dread(struct blk_desc *blk, lbaint_t start, lbaint_t blkcnt,
+		   void *buf);
+
+/**
+ * fs_get_bounced() - get the number of bytes copied by filesystem reads
+ *
+ * Return: total number of bytes which had to be copied into the destination
+ *	   because they could not be read there directly
+ */
+ulong fs_get_bounced(void);
+
+/**
+ * fs_add_bounced() - account for bytes copied through a bounce buffer
+ *
+ * @bytes:	number of bytes copied
+ */
+void fs_add_bounced(ulong bytes);
+
 #endif /* __U_BOOT_FS_INTERNAL_H__ */
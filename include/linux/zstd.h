@@ -1149,6 +1149,9 @@ struct abuf;
 /**
  * zstd_decompress() - Decompress Zstandard data
  *
+ * Data after the last frame which is not a frame itself, e.g. zero padding,
+ * is ignored.
+ *
  * @in: Input buffer to decompress
  * @out: Output buffer to hold the results (must be large enough)
  * @return size of the decompressed data, or -ve on error
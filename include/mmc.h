@@ -644,6 +644,24 @@ static inline bool supports_uhs(uint caps)
 #endif
 }
 
+/**
+ * struct mmc_read_stats - where the time spent reading blocks goes
+ *
+ * @setup_us:	Selecting the hardware partition and the block length
+ * @data_us:	Read commands, including the data transfer by the host driver
+ *		(DMA, cache maintenance and any bounce buffer copies)
+ * @stop_us:	Stop commands ending multiple block reads
+ * @cmds:	Number of read commands sent
+ * @blocks:	Number of blocks read
+ */
+struct mmc_read_stats {
+	u64 setup_us;
+	u64 data_us;
+	u64 stop_us;
+	ulong cmds;
+	ulong blocks;
+};
+
 /*
  * With CONFIG_DM_MMC enabled, struct mmc can be accessed from the MMC device
  * with mmc_get_mmc_dev().
@@ -728,6 +746,9 @@ struct mmc {
 	u8 hs400_tuning;
 
 	enum bus_mode user_speed_mode; /* input speed mode from user */
+#if CONFIG_IS_ENABLED(MMC_READ_STATS)
+	struct mmc_read_stats read_stats;
+#endif
 };
 
 #if CONFIG_IS_ENABLED(DM_MMC)
@@ -36,8 +36,10 @@ struct udevice;
  *
  */
 
-#ifdef CONFIG_SYS_RX_ETH_BUFFER
+#if defined(CONFIG_SYS_RX_ETH_BUFFER)
 # define PKTBUFSRX	CONFIG_SYS_RX_ETH_BUFFER
+#elif defined(CONFIG_NET_RX_BUFFERS)
+# define PKTBUFSRX	CONFIG_NET_RX_BUFFERS
 #else
 # define PKTBUFSRX	4
 #endif
@@ -143,6 +145,12 @@ enum eth_recv_flags {
  *	 indicate that the hardware receive FIFO is empty. If 0 is returned, the
  *	 network stack will not process the empty packet, but free_pkt() will be
  *	 called if supplied
+ * recv_batch: Like recv, but hand back every packet the hardware has received,
+ *	       up to max, in one call. The packet pointers and lengths are
+ *	       stored in packets and lengths and the number of packets is
+ *	       returned (0 if none). free_pkt() is called for each of them,
+ *	       in order, once the stack has processed it. If supplied, this is
+ *	       used instead of recv - optional
  * free_pkt: Give the driver an opportunity to manage its packet buffer memory
  *	     when the network stack is finished processing it. This will only be
  *	     called when no error was returned from recv - optional
@@ -159,17 +167,27 @@ enum eth_recv_flags {
  *		    to the network stack. This function should fill in the
  *		    eth_pdata::enetaddr field - optional
  * set_promisc: Enable or Disable promiscuous mode
+ * get_features: Return the checksum offloads the hardware provides while
+ *		 started, as a mask of enum eth_features - optional
+ * get_tx_buffer: Lend the stack a DMA buffer of at least PKTSIZE_ALIGN bytes
+ *		  to build outgoing frames in while started. A packet passed to
+ *		  send() may then already be in this buffer and need not be
+ *		  copied - optional
  */
 struct eth_ops {
 	int (*start)(struct udevice *dev);
 	int (*send)(struct udevice *dev, void *packet, int length);
 	int (*recv)(struct udevice *dev, int flags, uchar **packetp);
+	int (*recv_batch)(struct udevice *dev, int flags, uchar **packets,
+			  int *lengths, int max);
 	int (*free_pkt)(struct udevice *dev, uchar *packet, int length);
 	void (*stop)(struct udevice *dev);
 	int (*mcast)(struct udevice *dev, const u8 *enetaddr, int join);
 	int (*write_hwaddr)(struct udevice *dev);
 	int (*read_rom_hwaddr)(struct udevice *dev);
 	int (*set_promisc)(struct udevice *dev, bool enable);
+	int (*get_features)(struct udevice *dev);
+	int (*get_tx_buffer)(struct udevice *dev, uchar **bufp);
 };
 
 #define eth_get_ops(dev) ((struct eth_ops *)(dev)->driver->ops)
@@ -306,7 +324,24 @@ int eth_send(void *packet, int length);	   /* Send a packet */
 int eth_receive(void *packet, int length); /* Receive a packet*/
 extern void (*push_packet)(void *packet, int length);
 #endif
-int eth_rx(void);			/* Check for received packets */
+/*
+ * Check for received packets and process them. Returns a positive value if
+ * packets were processed (their number with driver model), 0 if there were
+ * none, or -ve on error.
+ */
+int eth_rx(void);
+/* Offloads an Ethernet driver can provide, see eth_get_features() */
+enum eth_features {
+	/* Frames with a bad IPv4 header, TCP or UDP checksum are dropped */
+	ETH_FEATURE_RX_CSUM		= 1 << 0,
+	/* The IPv4 header checksum is filled in on transmit */
+	ETH_FEATURE_TX_CSUM_IP		= 1 << 1,
+	/* The TCP and UDP checksums are filled in on transmit */
+	ETH_FEATURE_TX_CSUM_L4		= 1 << 2,
+};
+
+/* Offloads of the running device, as a mask of enum eth_features */
+int eth_get_features(void);
 void eth_halt(void);			/* stop SCC */
 const char *eth_get_name(void);		/* get name of current device */
 int eth_mcast_join(struct in_addr mcast_addr, int join);
@@ -371,6 +406,7 @@ struct vlan_ethernet_hdr {
 #define PROT_NCSI	0x88f8		/* NC-SI control packets        */
 
 #define IPPROTO_ICMP	 1	/* Internet Control Message Protocol	*/
+#define IPPROTO_TCP	 6	/* Transmission Control Protocol	*/
 #define IPPROTO_UDP	17	/* User Datagram Protocol		*/
 
 /*
@@ -562,7 +598,7 @@ extern int		net_restart_wrap;	/* Tried all network devices */
 
 enum proto_t {
 	BOOTP, RARP, ARP, TFTPGET, DHCP, PING, DNS, NFS, CDP, NETCONS, SNTP,
-	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP
+	TFTPSRV, TFTPPUT, LINKLOCAL, FASTBOOT, WOL, UDP, WGET
 };
 
 extern char	net_boot_file_name[1024];/* Boot File name */
@@ -607,6 +643,12 @@ extern int net_ntp_time_offset;			/* offset time from UTC */
 int net_init(void);
 int net_loop(enum proto_t);
 
+/*
+ * Build outgoing frames in the given buffer (lent by the Ethernet driver),
+ * or in our own if it is NULL
+ */
+void net_set_tx_buffer(uchar *buf);
+
 /* Load failed.	 Start again. */
 int net_start_again(void);
 
@@ -0,0 +1,157 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * TCP support for the U-Boot network stack
+ *
+ * A single client connection is supported. Received data is handed to the
+ * application as soon as it arrives, in or out of order, together with its
+ * offset in the stream, so that bulk transfers can be written straight to
+ * their destination without a reassembly buffer.
+ */
+
+#ifndef __TCP_H__
+#define __TCP_H__
+
+/*
+ *	Internet Protocol (IP) + TCP header.
+ */
+struct ip_tcp_hdr {
+	u8		ip_hl_v;	/* header length and version	*/
+	u8		ip_tos;		/* type of service		*/
+	u16		ip_len;		/* total length			*/
+	u16		ip_id;		/* identification		*/
+	u16		ip_off;		/* fragment offset field	*/
+	u8		ip_ttl;		/* time to live			*/
+	u8		ip_p;		/* protocol			*/
+	u16		ip_sum;		/* checksum			*/
+	struct in_addr	ip_src;		/* Source IP address		*/
+	struct in_addr	ip_dst;		/* Destination IP address	*/
+	u16		tcp_src;	/* TCP source port		*/
+	u16		tcp_dst;	/* TCP destination port		*/
+	u32		tcp_seq;	/* Sequence number		*/
+	u32		tcp_ack;	/* Acknowledgment number	*/
+	u8		tcp_hlen;	/* Header length / 4, upper 4 bits */
+	u8		tcp_flags;	/* Flags			*/
+	u16		tcp_win;	/* Window size			*/
+	u16		tcp_xsum;	/* Checksum			*/
+	u16		tcp_urg;	/* Urgent pointer		*/
+} __attribute__((packed));
+
+#define IP_TCP_HDR_SIZE		(sizeof(struct ip_tcp_hdr))
+#define TCP_HDR_SIZE		(IP_TCP_HDR_SIZE - IP_HDR_SIZE)
+
+/* TCP flags */
+#define TCP_FIN		0x01
+#define TCP_SYN		0x02
+#define TCP_RST		0x04
+#define TCP_PUSH	0x08
+#define TCP_ACK		0x10
+#define TCP_URG		0x20
+
+/* TCP options */
+#define TCP_OPT_END	0
+#define TCP_OPT_NOP	1
+#define TCP_OPT_MSS	2
+#define TCP_OPT_WS	3
+
+/* Largest segment we send or ask to receive (Ethernet MTU 1500) */
+#define TCP_MSS		1460
+
+/**
+ * enum tcp_event - events reported to the TCP handler
+ *
+ * @TCP_EV_CONNECTED:	The connection is established
+ * @TCP_EV_DATA:	Data was received, possibly out of order
+ * @TCP_EV_IN_ORDER:	All data before the given offset has been received
+ * @TCP_EV_CLOSED:	The peer closed the connection, all data is received
+ * @TCP_EV_RESET:	The connection was reset or timed out
+ */
+enum tcp_event {
+	TCP_EV_CONNECTED,
+	TCP_EV_DATA,
+	TCP_EV_IN_ORDER,
+	TCP_EV_CLOSED,
+	TCP_EV_RESET,
+};
+
+/**
+ * typedef rxhand_tcp_f - handler for TCP events
+ *
+ * @event:	What happened
+ * @data:	Received data for TCP_EV_DATA, NULL otherwise
+ * @offset:	Offset of @data in the received stream for TCP_EV_DATA, the
+ *		number of bytes received in order for TCP_EV_IN_ORDER
+ * @len:	Length of @data
+ * @return 0 if OK. For TCP_EV_DATA a non-zero value drops the data, so that
+ * the peer sends it again later.
+ */
+typedef int rxhand_tcp_f(enum tcp_event event, const uchar *data, u32 offset,
+			 unsigned int len);
+
+/**
+ * tcp_set_tcp_handler() - set the handler for events on the connection
+ *
+ * @f:	Handler to use, or NULL for none
+ */
+void tcp_set_tcp_handler(rxhand_tcp_f *f);
+
+/**
+ * tcp_connect() - open a connection to a server
+ *
+ * This sends the initial SYN. TCP_EV_CONNECTED is reported once the server
+ * has answered. Must be called from within net_loop().
+ *
+ * @dest:	Server IP address
+ * @dport:	Server port
+ * @return 0 if OK, -ve on error
+ */
+int tcp_connect(struct in_addr dest, int dport);
+
+/**
+ * tcp_send() - send data on the connection
+ *
+ * Only one segment can be outstanding at a time; it is sent again until
+ * the peer acknowledges it.
+ *
+ * @data:	Data to send
+ * @len:	Length of data, at most TCP_MSS
+ * @return 0 if OK, -EBUSY if earlier data is not acknowledged yet, other -ve
+ * on error
+ */
+int tcp_send(const void *data, unsigned int len);
+
+/**
+ * tcp_close() - close the connection
+ *
+ * This sends a FIN to the peer. No further events are reported.
+ */
+void tcp_close(void);
+
+/**
+ * tcp_receive() - handle a received TCP segment
+ *
+ * @ip:		IP packet holding the segment, with a valid IP header
+ * @len:	Length of the IP packet
+ */
+void tcp_receive(struct ip_tcp_hdr *ip, int len);
+
+/**
+ * tcp_set_tcp_header() - set up the IP and TCP headers of a segment
+ *
+ * The payload must already be in place after a TCP header without options
+ * (only SYN segments carry options, and they have no payload).
+ *
+ * @pkt:		Start of the IP header
+ * @dest:		Destination IP address
+ * @dport:		Destination port
+ * @sport:		Source port
+ * @payload_len:	Length of the payload
+ * @action:		TCP flags
+ * @tcp_seq_num:	Sequence number
+ * @tcp_ack_num:	Acknowledgment number
+ * @return size of the IP and TCP headers
+ */
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num);
+
+#endif /* __TCP_H__ */
@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * HTTP download ("wget") over TCP
+ */
+
+#ifndef __WGET_H__
+#define __WGET_H__
+
+/**
+ * wget_start() - start downloading net_boot_file_name over HTTP
+ *
+ * The file name is a path on the server, optionally preceded by the
+ * server's IP address and a colon. The body of the response is stored at
+ * image_load_addr.
+ */
+void wget_start(void);
+
+#endif /* __WGET_H__ */
@@ -12,6 +12,9 @@ struct host_block_dev {
 #endif
 	char *filename;
 	int fd;
+#ifdef CONFIG_BLK
+	struct blk_req *req;	/* Request to carry out on the next poll */
+#endif
 };
 
 /**
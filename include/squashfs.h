@@ -23,4 +23,12 @@ int sqfs_exists(const char *filename);
 void sqfs_close(void);
 void sqfs_closedir(struct fs_dir_stream *dirs);
 
+/**
+ * sqfs_invalidate() - Drop the cached metadata of an image on a device
+ *
+ * @if_type:	IF_TYPE_x for type of device
+ * @devnum:	device index of particular type
+ */
+void sqfs_invalidate(int if_type, int devnum);
+
 #endif /* SQFS_H  */
@@ -82,6 +82,15 @@ uint32_t crc32_wd(uint32_t crc, const unsigned char *buf, uint len,
  */
 uint32_t crc32_no_comp(uint32_t crc, const unsigned char *buf, uint len);
 
+/**
+ * crc32_exit_boot_services() - stop using the boot time CRC32 tables
+ *
+ * With CONFIG_CRC32_SLICE_BY_8, crc32() uses lookup tables which are not EFI
+ * runtime data. This is called when the EFI boot services are exited, after
+ * which only the byte-wise table is used.
+ */
+void crc32_exit_boot_services(void);
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
@@ -95,6 +104,9 @@ void crc32_wd_buf(const uint8_t *input, uint ilen, uint8_t *output,
 
 /* lib/crc32c.c */
 
+/* Bit-reflected Castagnoli polynomial, as used by btrfs */
+#define CRC32C_POLY_LE	0x82f63b78
+
 /**
  * crc32c_init() - Set up a the CRC32 table
  *
@@ -120,4 +132,19 @@ void crc32c_init(uint32_t *crc32c_table, uint32_t pol);
 uint32_t crc32c_cal(uint32_t crc, const char *data, int length,
 		    uint32_t *crc32c_table);
 
+/**
+ * crc32c_castagnoli() - Perform CRC32 with the Castagnoli polynomial
+ *
+ * This gives the same result as crc32c_cal() with a CRC32C_POLY_LE table, but
+ * uses the CRC32C instructions of the CPU where they are available.
+ *
+ * @crc: Previous crc (use 0 at start)
+ * @data: Data bytes to checksum
+ * @length: Number of bytes to process
+ * @crc32c_table: CRC table set up by crc32c_init() with CRC32C_POLY_LE
+ * @return checksum value
+ */
+uint32_t crc32c_castagnoli(uint32_t crc, const char *data, int length,
+			   uint32_t *crc32c_table);
+
 #endif /* _UBOOT_CRC_H */
@@ -60,6 +60,21 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
  */
 void sha1_finish( sha1_context *ctx, unsigned char output[20] );
 
+/**
+ * \brief	   SHA-1 process whole 64-byte blocks
+ *
+ * The generic version may be replaced by an architecture-specific one,
+ * which can fall back on sha1_process_generic().
+ *
+ * \param ctx	   SHA-1 context
+ * \param data	   buffer holding the blocks
+ * \param blocks   number of blocks
+ */
+void sha1_process(sha1_context *ctx, const unsigned char *data,
+		  unsigned int blocks);
+void sha1_process_generic(sha1_context *ctx, const unsigned char *data,
+			  unsigned int blocks);
+
 /**
  * \brief	   Output = SHA-1( input buffer )
  *
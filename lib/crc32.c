@@ -31,6 +31,14 @@
 
 #define tole(x) cpu_to_le32(x)
 
+#if __BYTE_ORDER == __LITTLE_ENDIAN && !defined(CONFIG_ARM64_CRC32)
+#ifdef USE_HOSTCC
+#define CRC32_SLICE_BY_8
+#elif CONFIG_IS_ENABLED(CRC32_SLICE_BY_8)
+#define CRC32_SLICE_BY_8
+#endif
+#endif
+
 #ifdef CONFIG_DYNAMIC_CRC_TABLE
 
 static int __efi_runtime_data crc_table_empty = 1;
@@ -157,6 +165,66 @@ tole(0xb40bbe37L), tole(0xc30c8ea1L), tole(0x5a05df1bL), tole(0x2d02ef8dL)
 };
 #endif
 
+#ifdef CRC32_SLICE_BY_8
+/*
+ * crc_slice[k][n] is the CRC of byte n followed by k + 1 zero bytes, so
+ * eight bytes can be folded into the CRC with eight independent lookups.
+ *
+ * The tables are boot time data. Only crc_table is kept for the EFI
+ * runtime, see crc32_exit_boot_services().
+ */
+static int crc_slice_empty = 1;
+static uint32_t crc_slice[7][256];
+static int __efi_runtime_data crc_slice_disabled;
+
+static void make_crc_slice(void)
+{
+	uint32_t c;
+	int n, k;
+
+#ifdef CONFIG_DYNAMIC_CRC_TABLE
+	if (crc_table_empty)
+		make_crc_table();
+#endif
+	for (n = 0; n < 256; n++) {
+		c = crc_table[n];
+		for (k = 0; k < 7; k++) {
+			c = crc_table[c & 255] ^ (c >> 8);
+			crc_slice[k][n] = c;
+		}
+	}
+	crc_slice_empty = 0;
+}
+
+/* Fold in @count blocks of eight bytes from the 32-bit aligned @b */
+static uint32_t crc32_slice8(uint32_t crc, const uint32_t *b, uInt count)
+{
+	if (crc_slice_empty)
+		make_crc_slice();
+
+	for (; count; count--, b += 2) {
+		uint32_t lo = b[0] ^ crc;
+		uint32_t hi = b[1];
+
+		crc = crc_slice[6][lo & 255] ^ crc_slice[5][(lo >> 8) & 255] ^
+		      crc_slice[4][(lo >> 16) & 255] ^ crc_slice[3][lo >> 24] ^
+		      crc_slice[2][hi & 255] ^ crc_slice[1][(hi >> 8) & 255] ^
+		      crc_slice[0][(hi >> 16) & 255] ^ crc_table[hi >> 24];
+	}
+
+	return crc;
+}
+#endif
+
+#ifndef USE_HOSTCC
+void crc32_exit_boot_services(void)
+{
+#ifdef CRC32_SLICE_BY_8
+	crc_slice_disabled = 1;
+#endif
+}
+#endif
+
 #if 0
 /* =========================================================================
  * This function can be used by asm versions of crc32()
@@ -186,6 +254,13 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 {
 #ifdef CONFIG_ARM64_CRC32
     crc = cpu_to_le32(crc);
+    /* Align to 8 bytes, then use the doubleword instruction */
+    while (len && ((long)buf & 7)) {
+        crc = __builtin_aarch64_crc32b(crc, *buf++);
+        len--;
+    }
+    for (; len >= 8; len -= 8, buf += 8)
+        crc = __builtin_aarch64_crc32x(crc, *(const uint64_t *)buf);
     while (len--)
         crc = __builtin_aarch64_crc32b(crc, *buf++);
     return le32_to_cpu(crc);
@@ -207,6 +282,14 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 	 b = (uint32_t *)p;
     }
 
+#ifdef CRC32_SLICE_BY_8
+    if (len >= 8 && !crc_slice_disabled) {
+	 crc = crc32_slice8(crc, b, len >> 3);
+	 b += (len >> 3) * 2;
+	 len &= 7;
+    }
+#endif
+
     rem_len = len & 3;
     len = len >> 2;
     for (--b; len; --len) {
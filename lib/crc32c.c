@@ -12,6 +12,23 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <u-boot/crc.h>
+
+#ifdef CONFIG_ARM64_CRC32
+static uint32_t crc32c_arm64(uint32_t crc, const u8 *p, int length)
+{
+	while (length > 0 && ((long)p & 7)) {
+		crc = __builtin_aarch64_crc32cb(crc, *p++);
+		length--;
+	}
+	for (; length >= 8; length -= 8, p += 8)
+		crc = __builtin_aarch64_crc32cx(crc, *(const u64 *)p);
+	while (length-- > 0)
+		crc = __builtin_aarch64_crc32cb(crc, *p++);
+
+	return crc;
+}
+#endif
 
 uint32_t crc32c_cal(uint32_t crc, const char *data, int length,
 		    uint32_t *crc32c_table)
@@ -22,6 +39,16 @@ uint32_t crc32c_cal(uint32_t crc, const char *data, int length,
 	return crc;
 }
 
+uint32_t crc32c_castagnoli(uint32_t crc, const char *data, int length,
+			   uint32_t *crc32c_table)
+{
+#ifdef CONFIG_ARM64_CRC32
+	return crc32c_arm64(crc, (const u8 *)data, length);
+#else
+	return crc32c_cal(crc, data, length, crc32c_table);
+#endif
+}
+
 void crc32c_init(uint32_t *crc32c_table, uint32_t pol)
 {
 	int i, j;
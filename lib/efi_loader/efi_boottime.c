@@ -2180,6 +2180,9 @@ static efi_status_t EFIAPI efi_exit_boot_services(efi_handle_t image_handle,
 	/* Fix up caches for EFI payloads if necessary */
 	efi_exit_caches();
 
+	/* Runtime services must not use boot time CRC32 tables */
+	crc32_exit_boot_services();
+
 	/* Disable boot time services */
 	systab.con_in_handle = NULL;
 	systab.con_in = NULL;
@@ -26,6 +26,8 @@
 #define COMMENT			0x10
 #define RESERVED		0xe0
 #define DEFLATED		8
+/* Most buffers gzwrite() uses, see gzwrite_nbufs() */
+#define GZWRITE_BUFS		2
 
 void *gzalloc(void *x, unsigned items, unsigned size)
 {
@@ -116,6 +118,80 @@ void gzwrite_progress_finish(int returnval,
 	}
 }
 
+/* A buffer being written to the device by gzwrite() */
+struct gzwrite_req {
+	lbaint_t blkcnt;	/* Number of blocks, 0 if none in flight */
+#if CONFIG_IS_ENABLED(BLK)
+	struct blk_req req;
+#endif
+};
+
+/*
+ * Start writing a buffer. With driver model this only submits the write, so
+ * devices which handle requests asynchronously return before it is done.
+ */
+static int gzwrite_start(struct blk_desc *dev, struct gzwrite_req *wr,
+			 lbaint_t start, lbaint_t blkcnt, void *buf)
+{
+#if CONFIG_IS_ENABLED(BLK)
+	int ret;
+
+	wr->req.start = start;
+	wr->req.blkcnt = blkcnt;
+	wr->req.buffer = buf;
+	wr->req.write = true;
+	ret = blk_submit(dev, &wr->req);
+	if (ret) {
+		printf("%s: cannot write block " LBAF " (err=%d)\n", __func__,
+		       start, ret);
+		return ret;
+	}
+	wr->blkcnt = blkcnt;
+#else
+	if (blk_dwrite(dev, start, blkcnt, buf) != blkcnt) {
+		printf("%s: write of block " LBAF " failed\n", __func__, start);
+		return -EIO;
+	}
+#endif
+
+	return 0;
+}
+
+/*
+ * One buffer can be written while the next is inflated, but only devices
+ * which handle requests asynchronously gain from the second buffer
+ */
+static int gzwrite_nbufs(struct blk_desc *dev)
+{
+#if CONFIG_IS_ENABLED(BLK)
+	if (blk_is_async(dev))
+		return GZWRITE_BUFS;
+#endif
+
+	return 1;
+}
+
+/* Wait for the write started by gzwrite_start(), if any, to complete */
+static int gzwrite_wait(struct blk_desc *dev, struct gzwrite_req *wr)
+{
+#if CONFIG_IS_ENABLED(BLK)
+	long n;
+
+	if (!wr->blkcnt)
+		return 0;
+	n = blk_wait(dev, &wr->req);
+	if (n != wr->blkcnt) {
+		printf("%s: write of block " LBAF " failed (%ld)\n", __func__,
+		       wr->req.start, n);
+		wr->blkcnt = 0;
+		return -EIO;
+	}
+	wr->blkcnt = 0;
+#endif
+
+	return 0;
+}
+
 int gzwrite(unsigned char *src, int len,
 	    struct blk_desc *dev,
 	    unsigned long szwritebuf,
@@ -125,13 +201,16 @@ int gzwrite(unsigned char *src, int len,
 	int i, flags;
 	z_stream s;
 	int r = 0;
+	unsigned char *writebufs[GZWRITE_BUFS] = { NULL };
 	unsigned char *writebuf;
+	struct gzwrite_req wr = { 0 };
 	unsigned crc = 0;
 	ulong totalfilled = 0;
 	lbaint_t blksperbuf, outblock;
 	u32 expected_crc;
 	u32 payload_size;
 	int iteration = 0;
+	int nbufs;
 
 	if (!szwritebuf ||
 	    (szwritebuf % dev->blksz) ||
@@ -205,7 +284,15 @@ int gzwrite(unsigned char *src, int len,
 
 	s.next_in = src + i;
 	s.avail_in = payload_size+8;
-	writebuf = (unsigned char *)malloc_cache_aligned(szwritebuf);
+	nbufs = gzwrite_nbufs(dev);
+	for (i = 0; i < nbufs; i++) {
+		writebufs[i] = malloc_cache_aligned(szwritebuf);
+		if (!writebufs[i]) {
+			printf("%s: out of memory\n", __func__);
+			r = -1;
+			goto out;
+		}
+	}
 
 	/* decompress until deflate stream ends or end of file */
 	do {
@@ -217,10 +304,18 @@ int gzwrite(unsigned char *src, int len,
 
 		/* run inflate() on input until output buffer not full */
 		do {
-			unsigned long blocks_written;
 			int numfilled;
 			lbaint_t writeblocks;
 
+			/*
+			 * With two buffers, the write of this one was waited
+			 * for below. A single one must be written out first.
+			 */
+			writebuf = writebufs[iteration % nbufs];
+			if (nbufs == 1 && gzwrite_wait(dev, &wr)) {
+				r = -1;
+				goto out;
+			}
 			s.avail_out = szwritebuf;
 			s.next_out = writebuf;
 			r = inflate(&s, Z_SYNC_FLUSH);
@@ -244,9 +339,13 @@ int gzwrite(unsigned char *src, int len,
 			gzwrite_progress(iteration++,
 					 totalfilled,
 					 szexpected);
-			blocks_written = blk_dwrite(dev, outblock,
-						    writeblocks, writebuf);
-			outblock += blocks_written;
+			if (gzwrite_wait(dev, &wr) ||
+			    gzwrite_start(dev, &wr, outblock, writeblocks,
+					  writebuf)) {
+				r = -1;
+				goto out;
+			}
+			outblock += writeblocks;
 			if (ctrlc()) {
 				puts("abort\n");
 				goto out;
@@ -256,16 +355,20 @@ int gzwrite(unsigned char *src, int len,
 		/* done when inflate() says it's done */
 	} while (r != Z_STREAM_END);
 
-	if ((szexpected != totalfilled) ||
+	if (gzwrite_wait(dev, &wr) ||
+	    (szexpected != totalfilled) ||
 	    (crc != expected_crc))
 		r = -1;
 	else
 		r = 0;
 
 out:
+	/* Nothing may still be writing from the buffers when freeing them */
+	gzwrite_wait(dev, &wr);
 	gzwrite_progress_finish(r, totalfilled, szexpected,
 				expected_crc, crc);
-	free(writebuf);
+	for (i = 0; i < nbufs; i++)
+		free(writebufs[i]);
 	inflateEnd(&s);
 
 	return r;
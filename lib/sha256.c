@@ -14,6 +14,8 @@
 #include <watchdog.h>
 #include <u-boot/sha256.h>
 
+#include <linux/compiler_attributes.h>
+
 const uint8_t sha256_der_prefix[SHA256_DER_LEN] = {
 	0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86,
 	0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05,
@@ -55,7 +57,7 @@ void sha256_starts(sha256_context * ctx)
 	ctx->state[7] = 0x5BE0CD19;
 }
 
-static void sha256_process(sha256_context *ctx, const uint8_t data[64])
+static void sha256_process_one(sha256_context *ctx, const uint8_t data[64])
 {
 	uint32_t temp1, temp2;
 	uint32_t W[64];
@@ -186,9 +188,24 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 	ctx->state[7] += H;
 }
 
+void sha256_process_generic(sha256_context *ctx, const uint8_t *data,
+			    uint32_t blocks)
+{
+	while (blocks--) {
+		sha256_process_one(ctx, data);
+		data += 64;
+	}
+}
+
+__weak void sha256_process(sha256_context *ctx, const uint8_t *data,
+			   uint32_t blocks)
+{
+	sha256_process_generic(ctx, data, blocks);
+}
+
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 {
-	uint32_t left, fill;
+	uint32_t left, fill, blocks;
 
 	if (!length)
 		return;
@@ -204,16 +221,17 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 
 	if (left && length >= fill) {
 		memcpy((void *) (ctx->buffer + left), (void *) input, fill);
-		sha256_process(ctx, ctx->buffer);
+		sha256_process(ctx, ctx->buffer, 1);
 		length -= fill;
 		input += fill;
 		left = 0;
 	}
 
-	while (length >= 64) {
-		sha256_process(ctx, input);
-		length -= 64;
-		input += 64;
+	blocks = length / 64;
+	if (blocks) {
+		sha256_process(ctx, input, blocks);
+		length -= blocks * 64;
+		input += blocks * 64;
 	}
 
 	if (length)
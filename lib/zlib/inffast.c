@@ -31,6 +31,31 @@
 #  define PUP(a) *++(a)
 #endif
 
+/*
+ * U-Boot: zlib.c includes this file a second time with INFLATE_FAST_WIDE
+ * defined, to build inflate_fast_wide(). There a constant-size memcpy()
+ * becomes a single load and store. arm64 is built with -mstrict-align for the
+ * code that runs with the MMU off, which is lifted for inflate_fast_wide()
+ * alone: inflate() only calls it with the data cache on.
+ */
+#ifdef INFLATE_FAST_WIDE
+#  define INFLATE_FAST_NAME inflate_fast_wide
+#  define INFLATE_FAST_MIN_IN INFLATE_FAST_WIDE_MIN_IN
+#  if BITS_PER_LONG == 64
+#    define INFLATE_FAST_REFILL64
+#  endif
+#  define COPY8(d, s) __builtin_memcpy((d), (s), 8)
+#  ifdef CONFIG_ARM64
+#    define INFLATE_FAST_ATTR __attribute__((target("no-strict-align")))
+#  endif
+#else
+#  define INFLATE_FAST_NAME inflate_fast
+#  define INFLATE_FAST_MIN_IN 6
+#endif
+#ifndef INFLATE_FAST_ATTR
+#  define INFLATE_FAST_ATTR
+#endif
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -66,7 +91,7 @@
       requires strm->avail_out >= 258 for each loop to avoid checking for
       output space.
  */
-void inflate_fast(z_streamp strm, unsigned start)
+void INFLATE_FAST_ATTR INFLATE_FAST_NAME(z_streamp strm, unsigned start)
 /* start: inflate()'s starting value for strm->avail_out */
 {
     struct inflate_state FAR *state;
@@ -98,14 +123,14 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* copy state to local variables */
     state = (struct inflate_state FAR *)strm->state;
     in = strm->next_in - OFF;
-    last = in + (strm->avail_in - 5);
-    if (in > last && strm->avail_in > 5) {
+    last = in + (strm->avail_in - (INFLATE_FAST_MIN_IN - 1));
+    if (in > last && strm->avail_in > INFLATE_FAST_MIN_IN - 1) {
         /*
          * overflow detected, limit strm->avail_in to the
          * max. possible size and recalculate last
          */
 	strm->avail_in = 0xffffffff - (uintptr_t)in;
-        last = in + (strm->avail_in - 5);
+        last = in + (strm->avail_in - (INFLATE_FAST_MIN_IN - 1));
     }
     out = strm->next_out - OFF;
     beg = out - (start - strm->avail_out);
@@ -127,12 +152,28 @@ void inflate_fast(z_streamp strm, unsigned start)
     /* decode literals and length/distances until end-of-block or not enough
        input data or output space */
     do {
+#ifdef INFLATE_FAST_REFILL64
+        /*
+         * Top up to at least 56 bits, enough for a whole length/distance
+         * pair. The bits loaded past the count are the following input, so
+         * or-ing the next load over them is harmless.
+         */
+        if (bits < 48) {
+            unsigned long w;
+
+            COPY8(&w, in + OFF);
+            hold |= (unsigned long)le64_to_cpu(w) << bits;
+            in += (63 - bits) >> 3;
+            bits |= 56;
+        }
+#else
         if (bits < 15) {
             hold += (unsigned long)(PUP(in)) << bits;
             bits += 8;
             hold += (unsigned long)(PUP(in)) << bits;
             bits += 8;
         }
+#endif
         this = lcode[hold & lmask];
       dolen:
         op = (unsigned)(this.bits);
@@ -252,6 +293,18 @@ void inflate_fast(z_streamp strm, unsigned start)
                             PUP(out) = PUP(from);
                     }
                 }
+#ifdef INFLATE_FAST_WIDE
+                else if (dist >= 8) {   /* no overlap within 8 bytes */
+                    unsigned char *o = out + OFF;
+
+                    from = o - dist;
+                    for (; len >= 8; len -= 8, o += 8, from += 8)
+                        COPY8(o, from);
+                    for (; len; len--)
+                        *o++ = *from++;
+                    out = o - OFF;
+                }
+#endif
                 else {
 		    unsigned short *sout;
 		    unsigned long loops;
@@ -326,12 +379,14 @@ void inflate_fast(z_streamp strm, unsigned start)
     len = bits >> 3;
     in -= len;
     bits -= len << 3;
-    hold &= (1U << bits) - 1;
+    hold &= (1UL << bits) - 1;
 
     /* update state and return */
     strm->next_in = in + OFF;
     strm->next_out = out + OFF;
-    strm->avail_in = (unsigned)(in < last ? 5 + (last - in) : 5 - (in - last));
+    strm->avail_in = (unsigned)(in < last ?
+                                (INFLATE_FAST_MIN_IN - 1) + (last - in) :
+                                (INFLATE_FAST_MIN_IN - 1) - (in - last));
     strm->avail_out = (unsigned)(out < end ?
                                  257 + (end - out) : 257 - (out - end));
     state->hold = hold;
@@ -353,4 +408,10 @@ void inflate_fast(z_streamp strm, unsigned start)
    - Moving len -= 3 statement into middle of loop
  */
 
+#undef INFLATE_FAST_NAME
+#undef INFLATE_FAST_MIN_IN
+#undef INFLATE_FAST_REFILL64
+#undef INFLATE_FAST_ATTR
+#undef COPY8
+
 #endif /* !ASMINF */
@@ -8,4 +8,32 @@
    subject to change. Applications should only use zlib.h.
  */
 
+/*
+ * U-Boot: with INFLATE_UNALIGNED, inffast.c is built a second time as
+ * inflate_fast_wide(), which copies matches eight bytes at a time and, on
+ * 64-bit, refills its bit buffer eight bytes at a time. The latter needs more
+ * input to be available on entry. clang ignores the attribute lifting
+ * -mstrict-align on arm64, so the wide variant would gain nothing there.
+ */
+#include <cpu_func.h>
+
+#if CONFIG_IS_ENABLED(INFLATE_UNALIGNED) && \
+    !(defined(CONFIG_ARM64) && defined(__clang__))
+#  define INFLATE_HAVE_WIDE
+#  if BITS_PER_LONG == 64
+#    define INFLATE_FAST_WIDE_MIN_IN 8
+#  else
+#    define INFLATE_FAST_WIDE_MIN_IN 6
+#  endif
+#endif
+
 void inflate_fast OF((z_streamp strm, unsigned start));
+#ifdef INFLATE_HAVE_WIDE
+void inflate_fast_wide OF((z_streamp strm, unsigned start));
+
+/* arm64 faults on unaligned accesses while the data cache is off */
+static inline int inflate_fast_wide_ok(void)
+{
+    return !IS_ENABLED(CONFIG_ARM64) || dcache_status();
+}
+#endif
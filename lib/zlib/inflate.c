@@ -724,6 +724,11 @@ int ZEXPORT inflate(z_streamp strm, int flush)
 	    WATCHDOG_RESET();
             if (have >= 6 && left >= 258) {
                 RESTORE();
+#ifdef INFLATE_HAVE_WIDE
+                if (have >= INFLATE_FAST_WIDE_MIN_IN && inflate_fast_wide_ok())
+                    inflate_fast_wide(strm, out);
+                else
+#endif
                 inflate_fast(strm, out);
                 LOAD();
                 break;
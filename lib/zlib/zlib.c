@@ -26,6 +26,11 @@
 #include "inffast.h"
 #include "inffixed.h"
 #include "inffast.c"
+#ifdef INFLATE_HAVE_WIDE
+#define INFLATE_FAST_WIDE
+#include "inffast.c"
+#undef INFLATE_FAST_WIDE
+#endif
 #include "inftrees.c"
 #include "inflate.c"
 #include "zutil.c"
@@ -9,18 +9,32 @@
 #include <abuf.h>
 #include <log.h>
 #include <malloc.h>
+#include <watchdog.h>
 #include <linux/zstd.h>
 
+/*
+ * Each frame is decompressed straight into the output with a decompression
+ * context. Unlike a stream this needs no window buffer, so there is no extra
+ * copy of the data and the workspace stays small whatever the window size.
+ * Frames are independent, so the seekable format (many frames followed by a
+ * skippable frame holding the seek table) is handled like any other input.
+ * Anything after the last frame which is not itself a frame, such as zero
+ * padding up to a sector or partition size, is ignored.
+ */
 int zstd_decompress(struct abuf *in, struct abuf *out)
 {
-	ZSTD_DStream *dstream;
-	ZSTD_inBuffer in_buf;
-	ZSTD_outBuffer out_buf;
+	const u8 *src = abuf_data(in);
+	size_t src_len = abuf_size(in);
+	u8 *dst = abuf_data(out);
+	size_t dst_len = abuf_size(out);
+	size_t done = 0;
+	bool any = false;
+	ZSTD_DCtx *dctx;
 	void *workspace;
 	size_t wsize;
 	int ret;
 
-	wsize = ZSTD_DStreamWorkspaceBound(abuf_size(in));
+	wsize = ZSTD_DCtxWorkspaceBound();
 	workspace = malloc(wsize);
 	if (!workspace) {
 		debug("%s: cannot allocate workspace of size %zu\n", __func__,
@@ -28,36 +42,47 @@ int zstd_decompress(struct abuf *in, struct abuf *out)
 		return -ENOMEM;
 	}
 
-	dstream = ZSTD_initDStream(abuf_size(in), workspace, wsize);
-	if (!dstream) {
-		log_err("%s: ZSTD_initDStream failed\n", __func__);
+	dctx = ZSTD_initDCtx(workspace, wsize);
+	if (!dctx) {
+		log_err("%s: ZSTD_initDCtx failed\n", __func__);
 		ret = -EPERM;
 		goto do_free;
 	}
 
-	in_buf.src = abuf_data(in);
-	in_buf.pos = 0;
-	in_buf.size = abuf_size(in);
-
-	out_buf.dst = abuf_data(out);
-	out_buf.pos = 0;
-	out_buf.size = abuf_size(out);
+	while (src_len) {
+		size_t frame_len, res;
 
-	while (1) {
-		size_t res;
+		if (any && !ZSTD_isFrame(src, src_len)) {
+			log_debug("Ignoring %zu bytes after the last frame\n",
+				  src_len);
+			break;
+		}
+		frame_len = ZSTD_findFrameCompressedSize(src, src_len);
+		if (ZSTD_isError(frame_len)) {
+			log_err("ZSTD frame error %d\n",
+				ZSTD_getErrorCode(frame_len));
+			ret = -EINVAL;
+			goto do_free;
+		}
 
-		res = ZSTD_decompressStream(dstream, &out_buf, &in_buf);
+		/* Skippable frames, such as the seek table, give no output */
+		res = ZSTD_decompressDCtx(dctx, dst + done, dst_len - done, src,
+					  frame_len);
 		if (ZSTD_isError(res)) {
 			ret = ZSTD_getErrorCode(res);
-			log_err("ZSTD_decompressStream error %d\n", ret);
+			log_err("ZSTD_decompressDCtx error %d\n", ret);
+			ret = ret == ZSTD_error_dstSize_tooSmall ? -ENOSPC :
+				-EINVAL;
 			goto do_free;
 		}
-
-		if (in_buf.pos >= abuf_size(in) || !res)
-			break;
+		done += res;
+		any = true;
+		src += frame_len;
+		src_len -= frame_len;
+		WATCHDOG_RESET();
 	}
 
-	ret = out_buf.pos;
+	ret = done;
 do_free:
 	free(workspace);
 	return ret;
@@ -44,6 +44,9 @@ struct eth_uclass_priv {
 /* eth_errno - This stores the most recent failure code from DM functions */
 static int eth_errno;
 
+/* eth_features - Offloads of the running device (enum eth_features) */
+static int eth_features;
+
 static struct eth_uclass_priv *eth_get_uclass_priv(void)
 {
 	struct uclass *uc;
@@ -261,6 +264,33 @@ static int on_ethaddr(const char *name, const char *value, enum env_op op,
 }
 U_BOOT_ENV_CALLBACK(ethaddr, on_ethaddr);
 
+/* Pick up the checksum offloads and transmit buffer of a started device */
+static void eth_start_offloads(struct udevice *dev)
+{
+	const struct eth_ops *ops = eth_get_ops(dev);
+	uchar *buf;
+
+	eth_features = ops->get_features ? ops->get_features(dev) : 0;
+	if (eth_features < 0)
+		eth_features = 0;
+
+	if (ops->get_tx_buffer && !ops->get_tx_buffer(dev, &buf))
+		net_set_tx_buffer(buf);
+	else
+		net_set_tx_buffer(NULL);
+}
+
+static void eth_stop_offloads(void)
+{
+	eth_features = 0;
+	net_set_tx_buffer(NULL);
+}
+
+int eth_get_features(void)
+{
+	return eth_features;
+}
+
 int eth_init(void)
 {
 	char *ethact = env_get("ethact");
@@ -302,6 +332,7 @@ int eth_init(void)
 
 					priv->state = ETH_STATE_ACTIVE;
 					priv->running = true;
+					eth_start_offloads(current);
 					return 0;
 				}
 			} else {
@@ -341,6 +372,7 @@ void eth_halt(void)
 	eth_get_ops(current)->stop(current);
 	priv->state = ETH_STATE_PASSIVE;
 	priv->running = false;
+	eth_stop_offloads();
 }
 
 int eth_is_active(struct udevice *dev)
@@ -378,6 +410,33 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+static int eth_rx_batch(struct udevice *dev)
+{
+	const struct eth_ops *ops = eth_get_ops(dev);
+	uchar *packets[ETH_PACKETS_BATCH_RECV];
+	int lengths[ETH_PACKETS_BATCH_RECV];
+	int count;
+	int i;
+
+	count = ops->recv_batch(dev, ETH_RECV_CHECK_DEVICE, packets, lengths,
+				ETH_PACKETS_BATCH_RECV);
+	if (count == -EAGAIN)
+		return 0;
+	if (count < 0) {
+		debug("%s: recv_batch() returned error %d\n", __func__, count);
+		return count;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (lengths[i] > 0)
+			net_process_received_packet(packets[i], lengths[i]);
+		if (ops->free_pkt)
+			ops->free_pkt(dev, packets[i], lengths[i]);
+	}
+
+	return count;
+}
+
 int eth_rx(void)
 {
 	struct udevice *current;
@@ -393,6 +452,9 @@ int eth_rx(void)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
+	if (eth_get_ops(current)->recv_batch)
+		return eth_rx_batch(current);
+
 	/* Process up to 32 packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
 	for (i = 0; i < ETH_PACKETS_BATCH_RECV; i++) {
@@ -410,8 +472,9 @@ int eth_rx(void)
 	if (ret < 0) {
 		/* We cannot completely return the error at present */
 		debug("%s: recv() returned error %d\n", __func__, ret);
+		return ret;
 	}
-	return ret;
+	return i;
 }
 
 int eth_initialize(void)
@@ -598,6 +661,11 @@ static int eth_post_probe(struct udevice *dev)
 static int eth_pre_remove(struct udevice *dev)
 {
 	struct eth_pdata *pdata = dev_get_plat(dev);
+	struct eth_device_priv *priv = dev_get_uclass_priv(dev);
+
+	/* The stack must not keep using a buffer lent by this device */
+	if (priv->running)
+		eth_stop_offloads();
 
 	eth_get_ops(dev)->stop(dev);
 
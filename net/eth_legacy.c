@@ -371,6 +371,11 @@ int eth_send(void *packet, int length)
 	return ret;
 }
 
+int eth_get_features(void)
+{
+	return 0;
+}
+
 int eth_rx(void)
 {
 	if (!eth_current)
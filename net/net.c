@@ -78,6 +78,15 @@
  *	Prerequisites:	- own ethernet address
  *	We want:	- magic packet or timeout
  *	Next step:	none
+ *
+ * WGET:
+ *
+ *	Prerequisites:	- own ethernet address
+ *			- own IP address
+ *			- HTTP server IP address
+ *			- name of file to be loaded
+ *	We want:	- load the file over HTTP/TCP
+ *	Next step:	none
  */
 
 
@@ -92,11 +101,13 @@
 #include <log.h>
 #include <net.h>
 #include <net/fastboot.h>
+#include <net/tcp.h>
 #include <net/tftp.h>
 #if defined(CONFIG_CMD_PCAP)
 #include <net/pcap.h>
 #endif
 #include <net/udp.h>
+#include <net/wget.h>
 #if defined(CONFIG_LED_STATUS)
 #include <miiphy.h>
 #include <status_led.h>
@@ -117,6 +128,9 @@
 #include "wol.h"
 #endif
 
+/* Most receive polls made before checking for ctrl-c and timeouts */
+#define NET_RX_DRAIN_MAX	16
+
 /** BOOTP EXTENTIONS **/
 
 /* Our subnet mask (0=unknown) */
@@ -195,6 +209,8 @@ static ulong	time_start;
 static ulong	time_delta;
 /* THE transmit packet */
 uchar *net_tx_packet;
+/* Our own transmit buffer, used unless the Ethernet driver lends one */
+static uchar *net_tx_packet_own;
 
 static int net_check_prereq(enum proto_t protocol);
 
@@ -375,12 +391,14 @@ int net_init(void)
 		 */
 		int i;
 
-		net_tx_packet = &net_pkt_buf[0] + (PKTALIGN - 1);
-		net_tx_packet -= (ulong)net_tx_packet % PKTALIGN;
+		net_tx_packet_own = &net_pkt_buf[0] + (PKTALIGN - 1);
+		net_tx_packet_own -= (ulong)net_tx_packet_own % PKTALIGN;
 		for (i = 0; i < PKTBUFSRX; i++) {
-			net_rx_packets[i] = net_tx_packet +
+			net_rx_packets[i] = net_tx_packet_own +
 				(i + 1) * PKTSIZE_ALIGN;
 		}
+		if (!net_tx_packet)
+			net_tx_packet = net_tx_packet_own;
 		arp_init();
 		net_clear_handlers();
 
@@ -391,6 +409,11 @@ int net_init(void)
 	return net_init_loop();
 }
 
+void net_set_tx_buffer(uchar *buf)
+{
+	net_tx_packet = buf ? buf : net_tx_packet_own;
+}
+
 /**********************************************************************/
 /*
  *	Main network processing loop.
@@ -400,6 +423,7 @@ int net_loop(enum proto_t protocol)
 {
 	int ret = -EINVAL;
 	enum net_loop_state prev_net_state = net_state;
+	int i;
 
 #if defined(CONFIG_CMD_PING)
 	if (protocol != PING)
@@ -526,6 +550,11 @@ restart:
 		case WOL:
 			wol_start();
 			break;
+#endif
+#if defined(CONFIG_CMD_WGET)
+		case WGET:
+			wget_start();
+			break;
 #endif
 		default:
 			break;
@@ -564,12 +593,17 @@ restart:
 			time_start = get_timer(0);
 
 		/*
-		 *	Check the ethernet for a new packet.  The ethernet
-		 *	receive routine will process it.
+		 *	Check the ethernet for new packets.  The ethernet
+		 *	receive routine will process them.  Keep going while
+		 *	packets arrive, so that a burst is taken off the
+		 *	receive ring before the slower housekeeping below.
 		 *	Most drivers return the most recent packet size, but not
 		 *	errors that may have happened.
 		 */
-		eth_rx();
+		for (i = 0; i < NET_RX_DRAIN_MAX; i++) {
+			if (eth_rx() <= 0 || net_state != NETLOOP_CONTINUE)
+				break;
+		}
 
 		/*
 		 *	Abort if ctrl-c was pressed.
@@ -847,6 +881,14 @@ int net_send_ip_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 				   payload_len);
 		pkt_hdr_size = eth_hdr_size + IP_UDP_HDR_SIZE;
 		break;
+#if defined(CONFIG_PROT_TCP)
+	case IPPROTO_TCP:
+		pkt_hdr_size = eth_hdr_size +
+			tcp_set_tcp_header(pkt + eth_hdr_size, dest, dport,
+					   sport, payload_len, action,
+					   tcp_seq_num, tcp_ack_num);
+		break;
+#endif
 	default:
 		return -EINVAL;
 	}
@@ -1208,8 +1250,9 @@ void net_process_received_packet(uchar *in_packet, int len)
 		/* Can't deal with IP options (headers != 20 bytes) */
 		if ((ip->ip_hl_v & 0x0f) > 0x05)
 			return;
-		/* Check the Checksum of the header */
-		if (!ip_checksum_ok((uchar *)ip, IP_HDR_SIZE)) {
+		/* Check the Checksum of the header, unless the MAC did */
+		if (!(eth_get_features() & ETH_FEATURE_RX_CSUM) &&
+		    !ip_checksum_ok((uchar *)ip, IP_HDR_SIZE)) {
 			debug("checksum bad\n");
 			return;
 		}
@@ -1253,6 +1296,11 @@ void net_process_received_packet(uchar *in_packet, int len)
 		if (ip->ip_p == IPPROTO_ICMP) {
 			receive_icmp(ip, len, src_ip, et);
 			return;
+#if defined(CONFIG_PROT_TCP)
+		} else if (ip->ip_p == IPPROTO_TCP) {
+			tcp_receive((struct ip_tcp_hdr *)ip, len);
+			return;
+#endif
 		} else if (ip->ip_p != IPPROTO_UDP) {	/* Only UDP packets */
 			return;
 		}
@@ -1355,6 +1403,9 @@ static int net_check_prereq(enum proto_t protocol)
 
 #if defined(CONFIG_CMD_NFS)
 	case NFS:
+#endif
+#if defined(CONFIG_CMD_WGET)
+	case WGET:
 #endif
 		/* Fall through */
 	case TFTPGET:
@@ -1495,7 +1546,8 @@ void net_set_ip_header(uchar *pkt, struct in_addr dest, struct in_addr source,
 	/* already in network byte order */
 	net_copy_ip((void *)&ip->ip_dst, &dest);
 
-	ip->ip_sum   = compute_ip_checksum(ip, IP_HDR_SIZE);
+	if (!(eth_get_features() & ETH_FEATURE_TX_CSUM_IP))
+		ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
 }
 
 void net_set_udp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
@@ -49,10 +49,36 @@
 #define NFS_RPC_ERR	1
 #define NFS_RPC_DROP	124
 
+#ifdef CONFIG_NFS_READ_REQUESTS
+# define NFS_READ_REQUESTS CONFIG_NFS_READ_REQUESTS
+#else
+# define NFS_READ_REQUESTS 1
+#endif
+/* Bytes loaded for each progress hash mark */
+#define NFS_HASH_BYTES	(NFS_READ_SIZE / 2 * 10)
+
+/* A READ reply carries the data plus up to a few hundred bytes of headers */
+#if defined(CONFIG_IP_DEFRAG) && NFS_READ_SIZE + 256 > CONFIG_NET_MAXDEFRAG
+#error "CONFIG_NFS_READ_SIZE is too large for CONFIG_NET_MAXDEFRAG"
+#endif
+
+/* A READ request in flight */
+struct nfs_read_slot {
+	unsigned long id;	/* RPC transaction ID */
+	int offset;		/* File offset asked for */
+	int len;		/* Number of bytes asked for */
+	ulong sent;		/* Time it was last sent */
+	bool busy;
+};
+
 static int fs_mounted;
 static unsigned long rpc_id;
-static int nfs_offset = -1;
+static int nfs_offset = -1;	/* Next file offset to ask for */
 static int nfs_len;
+static struct nfs_read_slot nfs_reads[NFS_READ_REQUESTS];
+static bool nfs_read_eof;	/* A read found the end of the file */
+static int nfs_read_bytes;	/* Bytes received so far */
+static int nfs_read_hashes;	/* Progress hash marks printed */
 static ulong nfs_timeout = NFS_TIMEOUT;
 
 static char dirfh[NFS_FHSIZE];	/* NFSv2 / NFSv3 file handle of directory */
@@ -175,15 +201,14 @@ static uint32_t *rpc_add_credentials(uint32_t *p)
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
-static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+static void rpc_req_id(unsigned long id, int rpc_prog, int rpc_proc,
+		       uint32_t *data, int datalen)
 {
 	struct rpc_t rpc_pkt;
-	unsigned long id;
 	uint32_t *p;
 	int pktlen;
 	int sport;
 
-	id = ++rpc_id;
 	rpc_pkt.u.call.id = htonl(id);
 	rpc_pkt.u.call.type = htonl(MSG_CALL);
 	rpc_pkt.u.call.rpcvers = htonl(2);	/* use RPC version 2 */
@@ -222,6 +247,11 @@ static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
 			    nfs_our_port, pktlen);
 }
 
+static void rpc_req(int rpc_prog, int rpc_proc, uint32_t *data, int datalen)
+{
+	rpc_req_id(++rpc_id, rpc_prog, rpc_proc, data, datalen);
+}
+
 /**************************************************************************
 RPC_LOOKUP - Lookup RPC Port numbers
 **************************************************************************/
@@ -361,7 +391,7 @@ static void nfs_lookup_req(char *fname)
 /**************************************************************************
 NFS_READ - Read File on NFS Server
 **************************************************************************/
-static void nfs_read_req(int offset, int readlen)
+static void nfs_read_req(struct nfs_read_slot *slot)
 {
 	uint32_t data[1024];
 	uint32_t *p;
@@ -373,22 +403,75 @@ static void nfs_read_req(int offset, int readlen)
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		memcpy(p, filefh, NFS_FHSIZE);
 		p += (NFS_FHSIZE / 4);
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(slot->offset);
+		*p++ = htonl(slot->len);
 		*p++ = 0;
 	} else { /* NFSV3_FLAG */
 		*p++ = htonl(filefh3_length);
 		memcpy(p, filefh, filefh3_length);
 		p += (filefh3_length / 4);
 		*p++ = htonl(0); /* offset is 64-bit long, so fill with 0 */
-		*p++ = htonl(offset);
-		*p++ = htonl(readlen);
+		*p++ = htonl(slot->offset);
+		*p++ = htonl(slot->len);
 		*p++ = 0;
 	}
 
 	len = (uint32_t *)p - (uint32_t *)&(data[0]);
 
-	rpc_req(PROG_NFS, NFS_READ, data, len);
+	/* A request sent again keeps its ID, so a late reply still counts */
+	rpc_req_id(slot->id, PROG_NFS, NFS_READ, data, len);
+	slot->sent = get_timer(0);
+}
+
+/* Ask for the next part of the file in each free request slot */
+static void nfs_read_issue(void)
+{
+	struct nfs_read_slot *slot;
+
+	for (slot = nfs_reads; slot < nfs_reads + NFS_READ_REQUESTS; slot++) {
+		if (slot->busy)
+			continue;
+		slot->id = ++rpc_id;
+		slot->offset = nfs_offset;
+		slot->len = nfs_len;
+		slot->busy = true;
+		nfs_offset += nfs_len;
+		nfs_read_req(slot);
+	}
+}
+
+/* Send the requests again which are unanswered (for too long, unless all) */
+static void nfs_read_resend(bool all)
+{
+	struct nfs_read_slot *slot;
+
+	for (slot = nfs_reads; slot < nfs_reads + NFS_READ_REQUESTS; slot++) {
+		if (slot->busy && (all || get_timer(slot->sent) > nfs_timeout))
+			nfs_read_req(slot);
+	}
+}
+
+static bool nfs_read_busy(void)
+{
+	int i;
+
+	for (i = 0; i < NFS_READ_REQUESTS; i++) {
+		if (nfs_reads[i].busy)
+			return true;
+	}
+
+	return false;
+}
+
+static void nfs_read_start(void)
+{
+	memset(nfs_reads, 0, sizeof(nfs_reads));
+	nfs_offset = 0;
+	nfs_len = NFS_READ_SIZE;
+	nfs_read_eof = false;
+	nfs_read_bytes = 0;
+	nfs_read_hashes = 0;
+	nfs_read_issue();
 }
 
 /**************************************************************************
@@ -421,7 +504,7 @@ static void nfs_send(void)
 		nfs_lookup_req(nfs_filename);
 		break;
 	case STATE_READ_REQ:
-		nfs_read_req(nfs_offset, nfs_len);
+		nfs_read_resend(true);
 		break;
 	case STATE_READLINK_REQ:
 		nfs_readlink_req();
@@ -664,9 +747,23 @@ static int nfs_readlink_reply(uchar *pkt, unsigned len)
 	return 0;
 }
 
-static int nfs_read_reply(uchar *pkt, unsigned len)
+static void nfs_read_progress(int rlen)
+{
+	nfs_read_bytes += rlen;
+	while (nfs_read_hashes < DIV_ROUND_UP(nfs_read_bytes, NFS_HASH_BYTES)) {
+		if (nfs_read_hashes && !(nfs_read_hashes % HASHES_PER_LINE))
+			puts("\n\t ");
+		putc('#');
+		nfs_read_hashes++;
+	}
+}
+
+static int nfs_read_reply(uchar *pkt, unsigned len,
+			  struct nfs_read_slot **slotp)
 {
 	struct rpc_t rpc_pkt;
+	struct nfs_read_slot *slot;
+	unsigned long id;
 	int rlen;
 	uchar *data_ptr;
 
@@ -674,10 +771,15 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 
 	memcpy(&rpc_pkt.u.data[0], pkt, sizeof(rpc_pkt.u.reply));
 
-	if (ntohl(rpc_pkt.u.reply.id) > rpc_id)
-		return -NFS_RPC_ERR;
-	else if (ntohl(rpc_pkt.u.reply.id) < rpc_id)
+	/* Match the reply to its request; anything else is a stale reply */
+	id = ntohl(rpc_pkt.u.reply.id);
+	for (slot = nfs_reads; slot < nfs_reads + NFS_READ_REQUESTS; slot++) {
+		if (slot->busy && slot->id == id)
+			break;
+	}
+	if (slot == nfs_reads + NFS_READ_REQUESTS)
 		return -NFS_RPC_DROP;
+	*slotp = slot;
 
 	if (rpc_pkt.u.reply.rstatus  ||
 	    rpc_pkt.u.reply.verifier ||
@@ -690,12 +792,6 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 		return -ntohl(rpc_pkt.u.reply.data[0]);
 	}
 
-	if ((nfs_offset != 0) && !((nfs_offset) %
-			(NFS_READ_SIZE / 2 * 10 * HASHES_PER_LINE)))
-		puts("\n\t ");
-	if (!(nfs_offset % ((NFS_READ_SIZE / 2) * 10)))
-		putc('#');
-
 	if (supported_nfs_versions & NFSV2_FLAG) {
 		rlen = ntohl(rpc_pkt.u.reply.data[18]);
 		data_ptr = (uchar *)&(rpc_pkt.u.reply.data[19]);
@@ -715,13 +811,44 @@ static int nfs_read_reply(uchar *pkt, unsigned len)
 
 	if (((uchar *)&(rpc_pkt.u.reply.data[0]) - (uchar *)(&rpc_pkt) + rlen) > len)
 			return -9999;
+	if (rlen > slot->len)
+		return -9999;
 
-	if (store_block(data_ptr, nfs_offset, rlen))
+	if (store_block(data_ptr, slot->offset, rlen))
 			return -9999;
 
 	return rlen;
 }
 
+/*
+ * Account for the answer to a READ request and keep the requests flowing.
+ * Returns true once the whole file has been received.
+ */
+static bool nfs_read_done(struct nfs_read_slot *slot, int rlen)
+{
+	nfs_read_progress(rlen);
+
+	if (!rlen) {
+		/* Nothing at this offset: the end of the file is before it */
+		nfs_read_eof = true;
+		slot->busy = false;
+	} else if (rlen < slot->len) {
+		/* Ask for the rest; this finds the end if that is where it is */
+		slot->id = ++rpc_id;
+		slot->offset += rlen;
+		slot->len -= rlen;
+		nfs_read_req(slot);
+	} else {
+		slot->busy = false;
+	}
+
+	if (!nfs_read_eof)
+		nfs_read_issue();
+	nfs_read_resend(false);
+
+	return nfs_read_eof && !nfs_read_busy();
+}
+
 /**************************************************************************
 Interfaces of U-BOOT
 **************************************************************************/
@@ -742,6 +869,7 @@ static void nfs_timeout_handler(void)
 static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			unsigned src, unsigned len)
 {
+	struct nfs_read_slot *slot;
 	int rlen;
 	int reply;
 
@@ -814,9 +942,7 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			nfs_send();
 		} else {
 			nfs_state = STATE_READ_REQ;
-			nfs_offset = 0;
-			nfs_len = NFS_READ_SIZE;
-			nfs_send();
+			nfs_read_start();
 		}
 		break;
 
@@ -839,22 +965,24 @@ static void nfs_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		break;
 
 	case STATE_READ_REQ:
-		rlen = nfs_read_reply(pkt, len);
+		rlen = nfs_read_reply(pkt, len, &slot);
 		if (rlen == -NFS_RPC_DROP)
 			break;
 		net_set_timeout_handler(nfs_timeout, nfs_timeout_handler);
-		if (rlen > 0) {
-			nfs_offset += rlen;
+		if (rlen >= 0) {
+			if (!nfs_read_done(slot, rlen))
+				break;
+			nfs_download_state = NETLOOP_SUCCESS;
+			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		} else if ((rlen == -NFSERR_ISDIR) || (rlen == -NFSERR_INVAL)) {
 			/* symbolic link */
+			memset(nfs_reads, 0, sizeof(nfs_reads));
 			nfs_state = STATE_READLINK_REQ;
 			nfs_send();
 		} else {
-			if (!rlen)
-				nfs_download_state = NETLOOP_SUCCESS;
-			if (rlen < 0)
-				debug("NFS READ error (%d)\n", rlen);
+			debug("NFS READ error (%d)\n", rlen);
+			memset(nfs_reads, 0, sizeof(nfs_reads));
 			nfs_state = STATE_UMOUNT_REQ;
 			nfs_send();
 		}
@@ -0,0 +1,554 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * TCP support for the U-Boot network stack
+ *
+ * This is a small client-side TCP, enough for bulk downloads: a single
+ * connection, a fixed receive window and cumulative ACKs. Out-of-order
+ * segments are handed to the application right away and their ranges are
+ * remembered, so that nothing has to be buffered here. Each of them is
+ * answered with a duplicate ACK, which makes the sender fast-retransmit the
+ * missing segment rather than wait for its retransmission timer.
+ */
+
+#include <common.h>
+#include <log.h>
+#include <net.h>
+#include <time.h>
+#include <asm/unaligned.h>
+#include <net/tcp.h>
+
+/* Interval of the TCP timer, which is also the delayed ACK timeout */
+#define TCP_TICK_MS		20
+/* Initial and maximum retransmission timeout */
+#define TCP_RTO_MS		500
+#define TCP_RTO_MAX_MS		8000
+#define TCP_MAX_RETRIES		8
+/* Give up if nothing is received for this long */
+#define TCP_IDLE_TIMEOUT_MS	30000
+/* Number of out-of-order ranges remembered */
+#define TCP_OOO_RANGES		8
+/* Number of segments received in order before an ACK is sent right away */
+#define TCP_ACK_SEGMENTS	2
+/* MSS assumed if the peer does not send one */
+#define TCP_DEFAULT_MSS		536
+
+enum tcp_state {
+	TCP_CLOSED,
+	TCP_SYN_SENT,
+	TCP_ESTABLISHED,
+	TCP_FIN_WAIT,		/* we closed first */
+	TCP_CLOSE_WAIT,		/* the peer closed first */
+	TCP_LAST_ACK,		/* both closed, waiting for our FIN's ACK */
+};
+
+/* A range of the received stream, as offsets */
+struct tcp_range {
+	u32 start;
+	u32 end;
+};
+
+static enum tcp_state tcp_state;
+static rxhand_tcp_f *tcp_handler;
+
+static struct in_addr tcp_remote_ip;
+static uchar tcp_remote_ethaddr[ARP_HLEN];
+static int tcp_remote_port;
+static int tcp_local_port;
+
+/* Send side, as sequence numbers */
+static u32 tcp_iss;		/* initial send sequence number */
+static u32 tcp_snd_una;		/* oldest unacknowledged */
+static u32 tcp_snd_nxt;		/* next to send */
+static unsigned int tcp_snd_mss;
+/* Data sent but not acknowledged yet, kept for retransmission */
+static uchar tcp_tx_data[TCP_MSS];
+static unsigned int tcp_tx_len;
+static u32 tcp_tx_seq;
+static bool tcp_fin_sent;
+
+/* Receive side, as offsets in the received stream */
+static u32 tcp_irs;		/* initial receive sequence number */
+static u32 tcp_rcv_nxt;		/* number of bytes received in order */
+static u32 tcp_rcv_wnd;
+static u8 tcp_rcv_wscale;
+static struct tcp_range tcp_ooo[TCP_OOO_RANGES];
+static int tcp_ooo_count;
+static bool tcp_fin_rcvd;
+static u32 tcp_fin_offset;
+static bool tcp_fin_done;	/* the peer's FIN has been consumed */
+static int tcp_segs_unacked;
+static bool tcp_ack_now;
+
+/* Timers, in get_timer() milliseconds */
+static ulong tcp_rto_start;
+static ulong tcp_rto_ms;
+static int tcp_retries;
+static ulong tcp_last_rx;
+
+void tcp_set_tcp_handler(rxhand_tcp_f *f)
+{
+	tcp_handler = f;
+}
+
+static int tcp_event(enum tcp_event event, const uchar *data, u32 offset,
+		     unsigned int len)
+{
+	if (!tcp_handler)
+		return 0;
+
+	return tcp_handler(event, data, offset, len);
+}
+
+/* Compute the checksum of a TCP segment, including the pseudo header */
+static uint tcp_checksum(struct ip_tcp_hdr *ip, int tcp_len)
+{
+	u16 pseudo[6];
+	uint sum;
+
+	memcpy(pseudo, &ip->ip_src, 2 * sizeof(struct in_addr));
+	pseudo[4] = htons(IPPROTO_TCP);
+	pseudo[5] = htons(tcp_len);
+	sum = compute_ip_checksum(pseudo, sizeof(pseudo));
+
+	return add_ip_checksums(sizeof(pseudo), sum,
+				compute_ip_checksum(&ip->tcp_src, tcp_len));
+}
+
+int tcp_set_tcp_header(uchar *pkt, struct in_addr dest, int dport, int sport,
+		       int payload_len, u8 action, u32 tcp_seq_num,
+		       u32 tcp_ack_num)
+{
+	struct ip_tcp_hdr *ip = (struct ip_tcp_hdr *)pkt;
+	uchar *opt = pkt + IP_TCP_HDR_SIZE;
+	int hlen = TCP_HDR_SIZE;
+	u32 win;
+
+	if (action & TCP_SYN) {
+		opt[0] = TCP_OPT_MSS;
+		opt[1] = 4;
+		put_unaligned_be16(TCP_MSS, opt + 2);
+		opt[4] = TCP_OPT_NOP;
+		opt[5] = TCP_OPT_WS;
+		opt[6] = 3;
+		opt[7] = tcp_rcv_wscale;
+		hlen += 8;
+		/* The window in a SYN is never scaled */
+		win = min_t(u32, tcp_rcv_wnd, 0xffff);
+	} else {
+		win = min_t(u32, tcp_rcv_wnd >> tcp_rcv_wscale, 0xffff);
+	}
+
+	net_set_ip_header(pkt, dest, net_ip, IP_HDR_SIZE + hlen + payload_len,
+			  IPPROTO_TCP);
+
+	ip->tcp_src = htons(sport);
+	ip->tcp_dst = htons(dport);
+	ip->tcp_seq = htonl(tcp_seq_num);
+	ip->tcp_ack = htonl(action & TCP_ACK ? tcp_ack_num : 0);
+	ip->tcp_hlen = (hlen / 4) << 4;
+	ip->tcp_flags = action;
+	ip->tcp_win = htons(win);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	if (!(eth_get_features() & ETH_FEATURE_TX_CSUM_L4))
+		ip->tcp_xsum = tcp_checksum(ip, hlen + payload_len);
+
+	return IP_HDR_SIZE + hlen;
+}
+
+/* Acknowledgment number for everything received so far */
+static u32 tcp_rcv_ack(void)
+{
+	return tcp_irs + 1 + tcp_rcv_nxt + (tcp_fin_done ? 1 : 0);
+}
+
+static void tcp_send_segment(u8 flags, u32 seq, const void *data,
+			     unsigned int len)
+{
+	uchar *pkt;
+
+	/*
+	 * The SYN is still waiting for ARP in the transmit buffer; it goes
+	 * out once the reply arrives
+	 */
+	if (arp_is_waiting())
+		return;
+
+	pkt = net_tx_packet + net_eth_hdr_size() + IP_TCP_HDR_SIZE;
+	if (len)
+		memcpy(pkt, data, len);
+	net_send_ip_packet(tcp_remote_ethaddr, tcp_remote_ip, tcp_remote_port,
+			   tcp_local_port, len, IPPROTO_TCP, flags, seq,
+			   tcp_rcv_ack());
+
+	if (flags & TCP_ACK) {
+		tcp_segs_unacked = 0;
+		tcp_ack_now = false;
+	}
+}
+
+static void tcp_send_ack(void)
+{
+	tcp_send_segment(TCP_ACK, tcp_snd_nxt, NULL, 0);
+}
+
+static void tcp_restart_rto(void)
+{
+	tcp_rto_start = get_timer(0);
+	tcp_rto_ms = TCP_RTO_MS;
+	tcp_retries = 0;
+}
+
+static void tcp_stop(void)
+{
+	tcp_state = TCP_CLOSED;
+	net_set_timeout_handler(0, NULL);
+}
+
+static void tcp_abort(void)
+{
+	tcp_stop();
+	tcp_event(TCP_EV_RESET, NULL, 0, 0);
+}
+
+static void tcp_retransmit(void)
+{
+	if (tcp_state == TCP_SYN_SENT) {
+		tcp_send_segment(TCP_SYN, tcp_iss, NULL, 0);
+		return;
+	}
+	if (tcp_tx_len)
+		tcp_send_segment(TCP_ACK | TCP_PUSH, tcp_tx_seq, tcp_tx_data,
+				 tcp_tx_len);
+	if (tcp_fin_sent)
+		tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt - 1, NULL, 0);
+}
+
+static void tcp_tick(void)
+{
+	net_set_timeout_handler(TCP_TICK_MS, tcp_tick);
+
+	if (tcp_segs_unacked)
+		tcp_send_ack();
+
+	if (get_timer(tcp_last_rx) > TCP_IDLE_TIMEOUT_MS) {
+		debug("TCP: connection timed out\n");
+		tcp_abort();
+		return;
+	}
+
+	/* Nothing of ours waiting for an ACK? */
+	if (tcp_state != TCP_SYN_SENT && tcp_snd_una == tcp_snd_nxt)
+		return;
+	if (get_timer(tcp_rto_start) < tcp_rto_ms)
+		return;
+
+	if (++tcp_retries > TCP_MAX_RETRIES) {
+		debug("TCP: too many retransmissions\n");
+		tcp_abort();
+		return;
+	}
+	tcp_rto_ms = min(tcp_rto_ms * 2, (ulong)TCP_RTO_MAX_MS);
+	tcp_rto_start = get_timer(0);
+	tcp_retransmit();
+}
+
+int tcp_connect(struct in_addr dest, int dport)
+{
+	tcp_remote_ip = dest;
+	tcp_remote_port = dport;
+	memset(tcp_remote_ethaddr, 0, ARP_HLEN);
+	tcp_local_port = 1024 + (get_timer(0) % 3072);
+
+	tcp_iss = (u32)get_ticks();
+	tcp_snd_una = tcp_iss;
+	tcp_snd_nxt = tcp_iss + 1;
+	tcp_snd_mss = TCP_DEFAULT_MSS;
+	tcp_tx_len = 0;
+	tcp_fin_sent = false;
+
+	tcp_rcv_nxt = 0;
+	tcp_rcv_wnd = CONFIG_TCP_RCV_WINDOW;
+	for (tcp_rcv_wscale = 0; (tcp_rcv_wnd >> tcp_rcv_wscale) > 0xffff;)
+		tcp_rcv_wscale++;
+	tcp_ooo_count = 0;
+	tcp_fin_rcvd = false;
+	tcp_fin_done = false;
+	tcp_segs_unacked = 0;
+	tcp_ack_now = false;
+
+	tcp_state = TCP_SYN_SENT;
+	tcp_last_rx = get_timer(0);
+	tcp_restart_rto();
+	tcp_send_segment(TCP_SYN, tcp_iss, NULL, 0);
+	net_set_timeout_handler(TCP_TICK_MS, tcp_tick);
+
+	return 0;
+}
+
+int tcp_send(const void *data, unsigned int len)
+{
+	if (tcp_state != TCP_ESTABLISHED && tcp_state != TCP_CLOSE_WAIT)
+		return -ENOTCONN;
+	if (tcp_tx_len)
+		return -EBUSY;
+	if (len > tcp_snd_mss)
+		return -EINVAL;
+
+	memcpy(tcp_tx_data, data, len);
+	tcp_tx_len = len;
+	tcp_tx_seq = tcp_snd_nxt;
+	tcp_snd_nxt += len;
+	tcp_restart_rto();
+	tcp_send_segment(TCP_ACK | TCP_PUSH, tcp_tx_seq, tcp_tx_data, len);
+
+	return 0;
+}
+
+void tcp_close(void)
+{
+	tcp_handler = NULL;
+
+	switch (tcp_state) {
+	case TCP_ESTABLISHED:
+		tcp_state = TCP_FIN_WAIT;
+		break;
+	case TCP_CLOSE_WAIT:
+		tcp_state = TCP_LAST_ACK;
+		break;
+	case TCP_SYN_SENT:
+		tcp_stop();
+		return;
+	default:
+		return;
+	}
+
+	tcp_fin_sent = true;
+	tcp_snd_nxt++;
+	tcp_restart_rto();
+	tcp_send_segment(TCP_FIN | TCP_ACK, tcp_snd_nxt - 1, NULL, 0);
+}
+
+/* Parse the options of the SYN-ACK */
+static bool tcp_parse_options(const uchar *opt, int len)
+{
+	bool wscale = false;
+
+	while (len > 0) {
+		if (opt[0] == TCP_OPT_END)
+			break;
+		if (opt[0] == TCP_OPT_NOP) {
+			opt++;
+			len--;
+			continue;
+		}
+		if (len < 2 || opt[1] < 2 || opt[1] > len)
+			break;
+		if (opt[0] == TCP_OPT_MSS && opt[1] == 4)
+			tcp_snd_mss = min_t(uint, get_unaligned_be16(opt + 2),
+					    TCP_MSS);
+		else if (opt[0] == TCP_OPT_WS && opt[1] == 3)
+			wscale = true;
+		len -= opt[1];
+		opt += opt[1];
+	}
+
+	return wscale;
+}
+
+static void tcp_process_ack(u32 ack)
+{
+	if ((s32)(ack - tcp_snd_una) <= 0 || (s32)(ack - tcp_snd_nxt) > 0)
+		return;
+
+	tcp_snd_una = ack;
+	tcp_restart_rto();
+	if (tcp_tx_len && (s32)(ack - (tcp_tx_seq + tcp_tx_len)) >= 0)
+		tcp_tx_len = 0;
+
+	if (tcp_state == TCP_LAST_ACK && ack == tcp_snd_nxt)
+		tcp_stop();
+}
+
+/* Remember a range received out of order */
+static void tcp_ooo_add(u32 start, u32 end)
+{
+	struct tcp_range *r;
+	int i;
+
+	for (i = 0; i < tcp_ooo_count; i++) {
+		r = &tcp_ooo[i];
+		if ((s32)(start - r->end) > 0 || (s32)(r->start - end) > 0)
+			continue;
+		if ((s32)(start - r->start) < 0)
+			r->start = start;
+		if ((s32)(end - r->end) > 0)
+			r->end = end;
+		return;
+	}
+
+	/* If there is no room the peer sends it again after the gap */
+	if (tcp_ooo_count < TCP_OOO_RANGES) {
+		tcp_ooo[tcp_ooo_count].start = start;
+		tcp_ooo[tcp_ooo_count].end = end;
+		tcp_ooo_count++;
+	}
+}
+
+/* Move tcp_rcv_nxt past any remembered ranges which now join up with it */
+static void tcp_ooo_merge(void)
+{
+	struct tcp_range *r;
+	bool merged;
+	int i;
+
+	do {
+		merged = false;
+		for (i = 0; i < tcp_ooo_count; i++) {
+			r = &tcp_ooo[i];
+			if ((s32)(r->start - tcp_rcv_nxt) > 0)
+				continue;
+			if ((s32)(r->end - tcp_rcv_nxt) > 0)
+				tcp_rcv_nxt = r->end;
+			tcp_ooo[i] = tcp_ooo[--tcp_ooo_count];
+			merged = true;
+			break;
+		}
+	} while (merged);
+}
+
+static void tcp_rx_data(const uchar *data, u32 offset, u32 len)
+{
+	u32 end = offset + len;
+	u32 wnd_end = tcp_rcv_nxt + tcp_rcv_wnd;
+
+	/* Anything already received or beyond the window is ACKed again */
+	if ((s32)(end - tcp_rcv_nxt) <= 0 || (s32)(offset - wnd_end) >= 0) {
+		tcp_ack_now = true;
+		return;
+	}
+	if ((s32)(offset - tcp_rcv_nxt) < 0) {
+		data += tcp_rcv_nxt - offset;
+		offset = tcp_rcv_nxt;
+	}
+	if ((s32)(end - wnd_end) > 0)
+		end = wnd_end;
+
+	if (tcp_event(TCP_EV_DATA, data, offset, end - offset)) {
+		tcp_ack_now = true;
+		return;
+	}
+
+	if (offset != tcp_rcv_nxt) {
+		/* A duplicate ACK tells the sender about the gap */
+		tcp_ooo_add(offset, end);
+		tcp_ack_now = true;
+		return;
+	}
+
+	tcp_rcv_nxt = end;
+	if (tcp_ooo_count) {
+		tcp_ooo_merge();
+		tcp_ack_now = true;
+	}
+	tcp_segs_unacked++;
+	tcp_event(TCP_EV_IN_ORDER, NULL, tcp_rcv_nxt, 0);
+}
+
+void tcp_receive(struct ip_tcp_hdr *ip, int len)
+{
+	struct in_addr src;
+	int hlen, dlen;
+	u32 seq, ack, offset;
+	u8 flags;
+
+	if (len < IP_TCP_HDR_SIZE)
+		return;
+	hlen = (ip->tcp_hlen >> 4) * 4;
+	if (hlen < TCP_HDR_SIZE || IP_HDR_SIZE + hlen > len)
+		return;
+	if (!(eth_get_features() & ETH_FEATURE_RX_CSUM) &&
+	    tcp_checksum(ip, len - IP_HDR_SIZE) & 0xfffe) {
+		debug("TCP: bad checksum\n");
+		return;
+	}
+
+	src = net_read_ip(&ip->ip_src);
+	if (tcp_state == TCP_CLOSED || src.s_addr != tcp_remote_ip.s_addr ||
+	    ntohs(ip->tcp_src) != tcp_remote_port ||
+	    ntohs(ip->tcp_dst) != tcp_local_port)
+		return;
+
+	flags = ip->tcp_flags;
+	seq = ntohl(ip->tcp_seq);
+	ack = ntohl(ip->tcp_ack);
+	dlen = len - IP_HDR_SIZE - hlen;
+
+	if (tcp_state == TCP_SYN_SENT) {
+		if (!(flags & TCP_ACK) || ack != tcp_iss + 1)
+			return;
+		if (flags & TCP_RST) {
+			tcp_abort();
+			return;
+		}
+		if (!(flags & TCP_SYN))
+			return;
+
+		tcp_irs = seq;
+		tcp_snd_una = ack;
+		/* Without the peer's agreement our window cannot be scaled */
+		if (!tcp_parse_options((uchar *)ip + IP_TCP_HDR_SIZE,
+				       hlen - TCP_HDR_SIZE)) {
+			tcp_rcv_wscale = 0;
+			tcp_rcv_wnd = min_t(u32, tcp_rcv_wnd, 0xffff);
+		}
+		tcp_state = TCP_ESTABLISHED;
+		tcp_last_rx = get_timer(0);
+		tcp_restart_rto();
+		tcp_send_ack();
+		tcp_event(TCP_EV_CONNECTED, NULL, 0, 0);
+		return;
+	}
+
+	offset = seq - tcp_irs - 1;
+	if (flags & TCP_RST) {
+		/* Only believe a reset which is within the window */
+		if (offset - tcp_rcv_nxt < tcp_rcv_wnd)
+			tcp_abort();
+		return;
+	}
+	tcp_last_rx = get_timer(0);
+
+	if (flags & TCP_ACK)
+		tcp_process_ack(ack);
+	if (tcp_state == TCP_CLOSED)
+		return;
+
+	if (dlen > 0)
+		tcp_rx_data((uchar *)ip + IP_HDR_SIZE + hlen, offset, dlen);
+
+	if ((flags & TCP_FIN) && !tcp_fin_rcvd) {
+		tcp_fin_rcvd = true;
+		tcp_fin_offset = offset + dlen;
+	}
+	if (flags & TCP_FIN)
+		tcp_ack_now = true;
+
+	if (tcp_fin_rcvd && !tcp_fin_done && tcp_rcv_nxt == tcp_fin_offset) {
+		tcp_fin_done = true;
+		tcp_ack_now = true;
+		if (tcp_state == TCP_ESTABLISHED) {
+			tcp_state = TCP_CLOSE_WAIT;
+			tcp_event(TCP_EV_CLOSED, NULL, 0, 0);
+		}
+	}
+
+	if (tcp_state != TCP_CLOSED &&
+	    (tcp_ack_now || tcp_segs_unacked >= TCP_ACK_SEGMENTS))
+		tcp_send_ack();
+
+	/* Both sides have closed and our FIN is acknowledged */
+	if (tcp_state == TCP_FIN_WAIT && tcp_fin_done &&
+	    tcp_snd_una == tcp_snd_nxt)
+		tcp_stop();
+}
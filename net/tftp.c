@@ -73,6 +73,11 @@ enum {
 	TFTP_ERR_OPTION_NEGOTIATION = 8,
 };
 
+/* Number of blocks ahead of the expected one that can be stored */
+#define TFTP_RCV_MAP_BLOCKS	256
+/* Out-of-order blocks tolerated before asking for the missing one again */
+#define TFTP_REORDER_BLOCKS	3
+
 static struct in_addr tftp_remote_ip;
 /* The UDP port at their end */
 static int	tftp_remote_port;
@@ -104,6 +109,17 @@ static ushort	tftp_windowsize;
 static ushort	tftp_next_ack;
 /* Last nack block we send */
 static ushort	tftp_last_nack;
+/* Blocks ahead of tftp_cur_block which are already stored, by block number */
+static u32	tftp_rcv_map[TFTP_RCV_MAP_BLOCKS / 32];
+/* Out-of-order blocks received since tftp_cur_block last moved */
+static int	tftp_rcv_ooo;
+/* Number of the short block which ends the file, if stored out of order */
+static ushort	tftp_rcv_last;
+static bool	tftp_rcv_last_valid;
+/* Blocks were lost during this transfer */
+static bool	tftp_loss;
+/* The window size asked for in the request */
+static ushort	tftp_window_size_req;
 #ifdef CONFIG_CMD_TFTPPUT
 /* 1 if writing, else 0 */
 static int	tftp_put_active;
@@ -157,6 +173,8 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = CONFIG_TFTP_BLOCKSIZE;
 static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
+/* Window size for the next transfer, see CONFIG_TFTP_ADAPTIVE_WINDOW */
+static unsigned short tftp_window_size_adapt;
 
 static inline int store_block(int block, uchar *src, unsigned int len)
 {
@@ -218,11 +236,31 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	memset(tftp_rcv_map, 0, sizeof(tftp_rcv_map));
+	tftp_rcv_ooo = 0;
+	tftp_rcv_last_valid = false;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
 }
 
+static bool tftp_rcv_test(ushort block)
+{
+	block %= TFTP_RCV_MAP_BLOCKS;
+
+	return tftp_rcv_map[block / 32] & BIT(block % 32);
+}
+
+static void tftp_rcv_set(ushort block, bool set)
+{
+	block %= TFTP_RCV_MAP_BLOCKS;
+
+	if (set)
+		tftp_rcv_map[block / 32] |= BIT(block % 32);
+	else
+		tftp_rcv_map[block / 32] &= ~BIT(block % 32);
+}
+
 #ifdef CONFIG_CMD_TFTPPUT
 /**
  * Load the next block from memory to be sent over tftp.
@@ -311,6 +349,76 @@ static void update_block_number(void)
 	show_block_marker();
 }
 
+/*
+ * Store a block which arrived ahead of the next expected one, so that it
+ * does not have to be sent again. Returns 1 if the missing block should be
+ * asked for, 0 if not, -ve on error.
+ */
+static int tftp_store_ahead(ushort block, uchar *src, unsigned int len)
+{
+	ushort ahead = block - (ushort)tftp_cur_block;
+
+	/* A block we already have, or too far ahead to keep track of */
+	if (ahead < 2 || ahead >= TFTP_RCV_MAP_BLOCKS)
+		return 1;
+
+	if (!tftp_rcv_test(block)) {
+		if (store_block(tftp_cur_block + ahead, src, len))
+			return -EIO;
+		tftp_rcv_set(block, true);
+		if (len < tftp_block_size) {
+			tftp_rcv_last = block;
+			tftp_rcv_last_valid = true;
+		}
+	}
+
+	/*
+	 * The remote sends nothing more until the end of its window, or of
+	 * the file, is acknowledged; otherwise allow for a little reordering
+	 * before assuming the block is lost.
+	 */
+	++tftp_rcv_ooo;
+	if (block == tftp_next_ack || len < tftp_block_size)
+		return 1;
+
+	return tftp_rcv_ooo >= TFTP_REORDER_BLOCKS;
+}
+
+/*
+ * Move past the blocks stored ahead which now follow on from the current
+ * one. Returns true if there were any.
+ */
+static bool tftp_rcv_advance(void)
+{
+	bool moved = false;
+
+	while (tftp_rcv_test(tftp_cur_block + 1)) {
+		tftp_rcv_set(tftp_cur_block + 1, false);
+		tftp_cur_block = (tftp_cur_block + 1) % TFTP_SEQUENCE_SIZE;
+		update_block_number();
+		tftp_prev_block = tftp_cur_block;
+		moved = true;
+	}
+
+	return moved;
+}
+
+/* Pick the window size to ask for in the next transfer */
+static void tftp_adapt_window(void)
+{
+	if (!IS_ENABLED(CONFIG_TFTP_ADAPTIVE_WINDOW) || tftp_put_active ||
+	    !tftp_window_size_req)
+		return;
+
+	if (tftp_loss)
+		tftp_window_size_adapt = max(tftp_window_size_req / 2, 1);
+	else
+		tftp_window_size_adapt = min(tftp_window_size_req * 2,
+					     (int)tftp_window_size_option);
+	debug("TFTP %s, next windowsize = %d\n",
+	      tftp_loss ? "lost blocks" : "no loss", tftp_window_size_adapt);
+}
+
 /* The TFTP get or put is complete */
 static void tftp_complete(void)
 {
@@ -336,6 +444,7 @@ static void tftp_complete(void)
 					map_sysmem(tftp_load_addr, 0),
 					net_boot_file_size);
 	}
+	tftp_adapt_window();
 	net_set_state(NETLOOP_SUCCESS);
 }
 
@@ -386,9 +495,9 @@ static void tftp_send(void)
 		 * Implemented only for tftp get.
 		 * Don't bother sending if it's 1
 		 */
-		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_req > 1)
 			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
-					0, tftp_window_size_option, 0);
+					0, tftp_window_size_req, 0);
 		len = pkt - xp;
 		break;
 
@@ -478,6 +587,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 	__be16 proto;
 	__be16 *s;
 	int i;
+	int ret;
 	u16 timeout_val_rcvd;
 
 	if (dest != tftp_our_port) {
@@ -610,6 +720,22 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			debug("Received unexpected block: %d, expected: %d\n",
 			      ntohs(*(__be16 *)pkt),
 			      (ushort)(tftp_cur_block + 1));
+			/*
+			 * Keep blocks which overtook a missing one; they are
+			 * written to their place and skipped once the gap is
+			 * filled.
+			 */
+			if (tftp_state == STATE_DATA) {
+				ret = tftp_store_ahead(ntohs(*(__be16 *)pkt),
+						       pkt + 2, len);
+				if (ret < 0) {
+					eth_halt();
+					net_set_state(NETLOOP_FAIL);
+					break;
+				}
+				if (!ret)
+					break;
+			}
 			/*
 			 * If one packet is dropped most likely
 			 * all other buffers in the window
@@ -621,6 +747,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				tftp_last_nack = tftp_cur_block;
 				tftp_next_ack = (ushort)(tftp_cur_block +
 							 tftp_windowsize);
+				tftp_loss = true;
 			}
 			break;
 		}
@@ -657,6 +784,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 
 		update_block_number();
 		tftp_prev_block = tftp_cur_block;
+		tftp_rcv_ooo = 0;
 		timeout_count_max = tftp_timeout_count_max;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 
@@ -672,6 +800,21 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			break;
 		}
 
+		/*
+		 *	The gap is filled: acknowledge the highest block we
+		 *	have, so the remote skips those it sent already.
+		 */
+		if (tftp_rcv_advance()) {
+			tftp_send();
+			tftp_last_nack = tftp_cur_block;
+			tftp_next_ack = (ushort)(tftp_cur_block +
+						 tftp_windowsize);
+			if (tftp_rcv_last_valid &&
+			    tftp_rcv_last == (ushort)tftp_cur_block)
+				tftp_complete();
+			break;
+		}
+
 		/*
 		 *	Acknowledge the block just received, which will prompt
 		 *	the remote for the next one.
@@ -714,6 +857,7 @@ static void tftp_timeout_handler(void)
 		restart("Retry count exceeded");
 	} else {
 		puts("T ");
+		tftp_loss = true;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
@@ -874,6 +1018,11 @@ void tftp_start(enum proto_t protocol)
 	tftp_cur_block = 0;
 	tftp_windowsize = 1;
 	tftp_last_nack = 0;
+	tftp_loss = false;
+	tftp_window_size_req = tftp_window_size_option;
+	if (IS_ENABLED(CONFIG_TFTP_ADAPTIVE_WINDOW) && tftp_window_size_adapt &&
+	    tftp_window_size_adapt < tftp_window_size_option)
+		tftp_window_size_req = tftp_window_size_adapt;
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
 	/* Revert tftp_block_size to dflt */
@@ -912,6 +1061,7 @@ void tftp_start_server(void)
 	tftp_block_size = TFTP_BLOCK_SIZE;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
+	tftp_window_size_req = 0;
 
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * HTTP download ("wget") over TCP
+ *
+ * The body of the response is written to memory at its offset as soon as
+ * each segment arrives, in order or not, so the download is only limited by
+ * the TCP window and never waits on a lock-step acknowledgment.
+ */
+
+#include <common.h>
+#include <efi_loader.h>
+#include <env.h>
+#include <image.h>
+#include <lmb.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/global_data.h>
+#include <net/tcp.h>
+#include <net/wget.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Well known HTTP port */
+#define HTTP_PORT		80
+/* Largest response header accepted */
+#define WGET_HDR_MAX		2048
+/* Bytes received for each progress hash mark */
+#define WGET_HASH_BYTES		(64 * 1024)
+#define WGET_HASHES_PER_LINE	65
+
+enum wget_state {
+	WGET_CONNECTING,
+	WGET_HEADER,
+	WGET_BODY,
+	WGET_DONE,
+};
+
+static enum wget_state wget_state;
+static struct in_addr wget_server_ip;
+static int wget_server_port;
+static char wget_path[sizeof(net_boot_file_name)];
+static ulong wget_load_addr;
+static ulong wget_load_size;
+static ulong wget_time_start;
+
+/* Response header, collected in order */
+static char wget_hdr[WGET_HDR_MAX + 1];
+static u32 wget_hdr_len;
+/* Offset of the body in the received stream */
+static u32 wget_body_offset;
+static ulong wget_content_len;
+static bool wget_content_len_known;
+static ulong wget_hashes;
+
+static void wget_fail(const char *msg)
+{
+	printf("\nwget error: %s\n", msg);
+	wget_state = WGET_DONE;
+	tcp_close();
+	net_set_state(NETLOOP_FAIL);
+}
+
+static void wget_done(void)
+{
+	ulong time;
+
+	wget_state = WGET_DONE;
+	tcp_close();
+
+	time = get_timer(wget_time_start);
+	if (time > 0) {
+		puts("\n\t ");	/* Line up with "Loading: " */
+		print_size(net_boot_file_size / time * 1000, "/s");
+	}
+	puts("\ndone\n");
+	if (IS_ENABLED(CONFIG_CMD_BOOTEFI))
+		efi_set_bootdev("Net", "", wget_path,
+				map_sysmem(wget_load_addr, 0),
+				net_boot_file_size);
+	net_set_state(NETLOOP_SUCCESS);
+}
+
+static int wget_send_request(void)
+{
+	char req[TCP_MSS];
+	int len;
+
+	len = snprintf(req, sizeof(req),
+		       "GET %s%s HTTP/1.1\r\n"
+		       "Host: %pI4\r\n"
+		       "User-Agent: U-Boot\r\n"
+		       "Connection: close\r\n\r\n",
+		       *wget_path == '/' ? "" : "/", wget_path,
+		       &wget_server_ip);
+	if (len >= sizeof(req) || tcp_send(req, len)) {
+		wget_fail("cannot send request (file name too long?)");
+		return -EINVAL;
+	}
+	wget_state = WGET_HEADER;
+
+	return 0;
+}
+
+/* Check the status line and pick out the headers we care about */
+static int wget_parse_header(void)
+{
+	char *line, *end, *p;
+	int status;
+
+	p = strchr(wget_hdr, ' ');
+	if (strncmp(wget_hdr, "HTTP/1.", 7) || !p) {
+		wget_fail("bad response");
+		return -EPROTO;
+	}
+	status = simple_strtoul(p + 1, NULL, 10);
+	if (status < 200 || status > 299) {
+		*strstr(wget_hdr, "\r\n") = '\0';
+		printf("\nServer replied '%s'", wget_hdr);
+		wget_fail("request failed");
+		return -ENOENT;
+	}
+
+	for (line = strstr(wget_hdr, "\r\n") + 2; *line; line = end + 2) {
+		end = strstr(line, "\r\n");
+		if (!end)
+			break;
+		*end = '\0';
+		if (!strncasecmp(line, "Content-Length:", 15)) {
+			for (p = line + 15; *p == ' ' || *p == '\t'; p++)
+				;
+			wget_content_len = simple_strtoul(p, NULL, 10);
+			wget_content_len_known = true;
+		} else if (!strncasecmp(line, "Transfer-Encoding:", 18) &&
+			   strstr(line + 18, "chunked")) {
+			wget_fail("chunked transfer encoding not supported");
+			return -EOPNOTSUPP;
+		}
+	}
+
+	return 0;
+}
+
+static int wget_store(const uchar *data, u32 offset, unsigned int len)
+{
+	void *ptr;
+
+	if (wget_content_len_known) {
+		if (offset >= wget_content_len)
+			return 0;
+		len = min_t(ulong, len, wget_content_len - offset);
+	}
+	if (wget_load_size && offset + len > wget_load_size) {
+		wget_fail("trying to overwrite reserved memory");
+		return -ENOSPC;
+	}
+
+	ptr = map_sysmem(wget_load_addr + offset, len);
+	memcpy(ptr, data, len);
+	unmap_sysmem(ptr);
+
+	return 0;
+}
+
+static int wget_rx_header(const uchar *data, u32 offset, unsigned int len)
+{
+	unsigned int n;
+	char *end;
+	int ret;
+
+	/* The header is collected in order; later data is sent again */
+	if (offset != wget_hdr_len)
+		return -EAGAIN;
+
+	n = min_t(uint, len, WGET_HDR_MAX - wget_hdr_len);
+	memcpy(wget_hdr + wget_hdr_len, data, n);
+	wget_hdr_len += n;
+	wget_hdr[wget_hdr_len] = '\0';
+
+	end = strstr(wget_hdr, "\r\n\r\n");
+	if (!end) {
+		if (wget_hdr_len == WGET_HDR_MAX) {
+			wget_fail("response header too large");
+			return -E2BIG;
+		}
+		return 0;
+	}
+	wget_body_offset = end + 4 - wget_hdr;
+	end[2] = '\0';
+
+	ret = wget_parse_header();
+	if (ret)
+		return ret;
+	wget_state = WGET_BODY;
+
+	/* Whatever follows the header in this segment starts the body */
+	if (offset + len > wget_body_offset)
+		return wget_store(data + wget_body_offset - offset, 0,
+				  offset + len - wget_body_offset);
+
+	return 0;
+}
+
+static void wget_progress(u32 size)
+{
+	net_boot_file_size = size;
+	while (wget_hashes < size / WGET_HASH_BYTES) {
+		putc('#');
+		if (++wget_hashes % WGET_HASHES_PER_LINE == 0)
+			puts("\n\t ");
+	}
+
+	if (wget_content_len_known && size >= wget_content_len) {
+		net_boot_file_size = wget_content_len;
+		wget_done();
+	}
+}
+
+static int wget_handler(enum tcp_event event, const uchar *data, u32 offset,
+			unsigned int len)
+{
+	if (wget_state == WGET_DONE)
+		return 0;
+
+	switch (event) {
+	case TCP_EV_CONNECTED:
+		return wget_send_request();
+	case TCP_EV_DATA:
+		if (wget_state == WGET_BODY)
+			return wget_store(data, offset - wget_body_offset, len);
+		return wget_rx_header(data, offset, len);
+	case TCP_EV_IN_ORDER:
+		if (wget_state == WGET_BODY)
+			wget_progress(offset - wget_body_offset);
+		break;
+	case TCP_EV_CLOSED:
+		if (wget_state != WGET_BODY)
+			wget_fail("connection closed by server");
+		else if (wget_content_len_known &&
+			 net_boot_file_size < wget_content_len)
+			wget_fail("connection closed before end of file");
+		else
+			wget_done();
+		break;
+	case TCP_EV_RESET:
+		wget_fail("connection reset or timed out");
+		break;
+	}
+
+	return 0;
+}
+
+/* Initialize wget_load_addr and wget_load_size from image_load_addr and lmb */
+static int wget_init_load_addr(void)
+{
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	phys_size_t max_size;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+
+	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	if (!max_size)
+		return -1;
+
+	wget_load_size = max_size;
+#endif
+	wget_load_addr = image_load_addr;
+	return 0;
+}
+
+void wget_start(void)
+{
+	wget_server_ip = net_server_ip;
+	if (!net_parse_bootfile(&wget_server_ip, wget_path,
+				sizeof(wget_path))) {
+		puts("\nwget error: no file name given\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+	wget_server_port = env_get_ulong("httpserverport", 10, HTTP_PORT);
+
+	if (wget_init_load_addr()) {
+		puts("\nwget error: trying to overwrite reserved memory...\n");
+		net_set_state(NETLOOP_FAIL);
+		return;
+	}
+
+	printf("HTTP from server %pI4; our IP address is %pI4\n",
+	       &wget_server_ip, &net_ip);
+	printf("Filename '%s'.\n", wget_path);
+	printf("Load address: 0x%lx\n", wget_load_addr);
+	puts("Loading: *\b");
+
+	wget_state = WGET_CONNECTING;
+	wget_hdr_len = 0;
+	wget_content_len = 0;
+	wget_content_len_known = false;
+	wget_hashes = 0;
+	wget_time_start = get_timer(0);
+	net_boot_file_size = 0;
+
+	tcp_set_tcp_handler(wget_handler);
+	tcp_connect(wget_server_ip, wget_server_port);
+}
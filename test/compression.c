@@ -4,6 +4,7 @@
  */
 
 #include <common.h>
+#include <abuf.h>
 #include <bootm.h>
 #include <command.h>
 #include <gzip.h>
@@ -22,6 +23,7 @@
 #include <lzma/LzmaTools.h>
 
 #include <linux/lzo.h>
+#include <linux/zstd.h>
 #include <test/compression.h>
 #include <test/suites.h>
 #include <test/ut.h>
@@ -121,6 +123,30 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/*
+ * Seekable format: the first 150 bytes and the rest compressed as separate
+ * frames with 'zstd -19 --no-check', followed by a skippable frame holding the
+ * seek table (magic 0x184d2a5e, two entries, footer magic 0x8f92eab1)
+ */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x20\x96\x15\x02\x00\x62\x44\x0e\x11\xa0\xed\xb8"
+	"\x49\x65\xb7\xca\x3e\xd9\xb2\x8d\xfa\xb7\xbc\xdf\x33\x23\xa9\xdf"
+	"\xb3\x3c\x70\x3b\x2f\xc5\x5e\xdd\xb6\x73\xdc\x73\xe4\x44\x80\x68"
+	"\xca\xfd\xf3\xde\xaa\x9c\x59\x59\x29\x39\xc2\xf6\xcc\x2b\x4b\x48"
+	"\xa5\xef\xdb\x7e\x04\x01\x00\xe8\x85\xaa\x32\x28\xb5\x2f\xfd\x20"
+	"\xc8\x55\x04\x00\x92\x8b\x1f\x16\x90\x59\x07\xc0\x7e\x24\x98\x76"
+	"\x1b\xca\x6f\xc1\x8e\x3b\xf5\x2f\x9a\xf2\x28\xdf\x2f\x1d\x47\xd0"
+	"\x23\xa9\x7a\x76\x76\xf9\xfa\x70\x3e\x4a\x66\x41\xe7\x9e\xaf\x64"
+	"\x7a\x61\xb7\x56\x98\x7f\x2f\x9d\x90\x4a\xf1\x04\x4c\x46\xa6\xa5"
+	"\x03\xd7\x2c\xa7\x55\xd1\xab\xf9\xe5\x1d\x2c\x1c\xe5\x7a\x5e\x85"
+	"\xea\xf0\xd3\xba\x29\x9f\x19\x69\x4a\xf5\xf0\x31\x87\x4e\x53\xbe"
+	"\xb6\xab\x13\x4a\x98\x5f\x78\x81\x66\xac\xc4\x45\x1f\x3e\xad\x03"
+	"\xf8\x85\x2e\xa9\x99\x96\x3e\x7c\x34\xe1\x83\x38\xc2\x9b\x62\x56"
+	"\xe5\x37\x67\x55\x01\x02\x00\x18\x1b\x65\x14\x15\x41\x0a\x5e\x2a"
+	"\x4d\x18\x19\x00\x00\x00\x4b\x00\x00\x00\x96\x00\x00\x00\x93\x00"
+	"\x00\x00\xc8\x00\x00\x00\x02\x00\x00\x00\x00\xb1\xea\x92\x8f";
+static const unsigned long zstd_compressed_size = 255;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -296,6 +322,44 @@ static int uncompress_using_lz4(struct unit_test_state *uts,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(struct unit_test_state *uts,
+			       void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	ut_asserteq(in_size, strlen(plain));
+	ut_asserteq_mem(plain, in, in_size);
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(struct unit_test_state *uts,
+				 void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	struct abuf inb, outb;
+	int ret;
+
+	abuf_init_set(&inb, in, in_size);
+	abuf_init_set(&outb, out, out_max);
+	ret = zstd_decompress(&inb, &outb);
+	if (ret < 0)
+		return 1;
+	if (out_size)
+		*out_size = ret;
+
+	return 0;
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -440,6 +504,56 @@ static int compression_test_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_lz4, 0);
 
+static int compression_test_zstd(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_ZSTD))
+		return 0;
+
+	return run_test(uts, "zstd", compress_using_zstd,
+			uncompress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_zstd, 0);
+
+/* Test that data after the last zstd frame, such as padding, is ignored */
+static int compression_test_zstd_padded(struct unit_test_state *uts)
+{
+	const ulong in_size = 512, out_size = TEST_BUFFER_SIZE;
+	struct abuf inb, outb;
+	u8 *in, *out;
+
+	if (!IS_ENABLED(CONFIG_ZSTD))
+		return 0;
+
+	in = malloc(in_size);
+	ut_assertnonnull(in);
+	out = malloc(out_size);
+	ut_assertnonnull(out);
+
+	/* Zero padding, as at the end of a sector or partition */
+	memset(in, '\0', in_size);
+	memcpy(in, zstd_compressed, zstd_compressed_size);
+	abuf_init_set(&inb, in, in_size);
+	abuf_init_set(&outb, out, out_size);
+	ut_asserteq(strlen(plain), zstd_decompress(&inb, &outb));
+	ut_asserteq_mem(plain, out, strlen(plain));
+
+	/* Trailing data which is not a frame */
+	memset(in + zstd_compressed_size, 0xa5, in_size - zstd_compressed_size);
+	memset(out, '\0', out_size);
+	ut_asserteq(strlen(plain), zstd_decompress(&inb, &outb));
+	ut_asserteq_mem(plain, out, strlen(plain));
+
+	/* Input which does not start with a frame is still an error */
+	memset(in, '\0', in_size);
+	ut_asserteq(-EINVAL, zstd_decompress(&inb, &outb));
+
+	free(out);
+	free(in);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_padded, 0);
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -530,6 +644,15 @@ static int compression_test_bootm_lz4(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_lz4, 0);
 
+static int compression_test_bootm_zstd(struct unit_test_state *uts)
+{
+	if (!IS_ENABLED(CONFIG_ZSTD))
+		return 0;
+
+	return run_bootm_test(uts, IH_COMP_ZSTD, compress_using_zstd);
+}
+COMPRESSION_TEST(compression_test_bootm_zstd, 0);
+
 static int compression_test_bootm_none(struct unit_test_state *uts)
 {
 	return run_bootm_test(uts, IH_COMP_NONE, compress_using_none);
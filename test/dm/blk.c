@@ -5,7 +5,11 @@
 
 #include <common.h>
 #include <dm.h>
+#include <gzip.h>
+#include <malloc.h>
+#include <os.h>
 #include <part.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/global_data.h>
 #include <asm/state.h>
@@ -217,3 +221,237 @@ static int dm_test_blk_iter(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_iter, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test the block cache and its read-ahead */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats;
+	struct blk_desc *dev_desc;
+	char write[16384], read[1024];
+	struct udevice *dev;
+	void *big;
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+
+	/* 8 blocks per entry, 4 sets of 4 entries */
+	blkcache_configure(8, 16);
+
+	/* The first read from a device does not continue a stream */
+	ut_asserteq(1, blk_dread(dev_desc, 0, 1, read));
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(0, stats.readaheads);
+
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i / 7;
+	ut_asserteq(32, blk_dwrite(dev_desc, 8, 32, write));
+
+	/* A small read fetches the whole entry, so its neighbours hit */
+	ut_asserteq(1, blk_dread(dev_desc, 9, 1, read));
+	ut_asserteq_mem(write + 512, read, 512);
+	ut_asserteq(2, blk_dread(dev_desc, 14, 2, read));
+	ut_asserteq_mem(write + 6 * 512, read, 1024);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(0, stats.readaheads);
+	ut_asserteq(1, stats.entries);
+
+	/* Continuing where the last device read ended reads ahead */
+	ut_asserteq(1, blk_dread(dev_desc, 16, 1, read));
+	ut_asserteq_mem(write + 8 * 512, read, 512);
+	ut_asserteq(2, blk_dread(dev_desc, 23, 2, read));
+	ut_asserteq_mem(write + 15 * 512, read, 1024);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.hits);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(1, stats.readaheads);
+	ut_asserteq(3, stats.entries);
+
+	/* A write drops everything cached for the device */
+	ut_asserteq(1, blk_dwrite(dev_desc, 40, 1, write));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(1, blk_dread(dev_desc, 17, 1, read));
+	ut_asserteq_mem(write + 9 * 512, read, 512);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.hits);
+	ut_asserteq(1, stats.misses);
+
+	/* Reads larger than the read-ahead window are not cached */
+	big = malloc((CONFIG_BLOCK_CACHE_READAHEAD + 8) * 512);
+	ut_assertnonnull(big);
+	ut_asserteq(CONFIG_BLOCK_CACHE_READAHEAD + 8,
+		    blk_dread(dev_desc, 64, CONFIG_BLOCK_CACHE_READAHEAD + 8,
+			      big));
+	free(big);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.misses);
+	ut_asserteq(0, stats.readaheads);
+	ut_asserteq(1, stats.entries);
+
+	blkcache_configure(CONFIG_BLOCK_CACHE_LINE_BLOCKS,
+			   CONFIG_BLOCK_CACHE_ENTRIES);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test asynchronous requests on a device which handles them synchronously */
+static int dm_test_blk_async(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	char write[2048], read[2048];
+	struct blk_req req;
+	struct udevice *dev;
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	ut_asserteq(1, blk_get_queue_depth(dev_desc));
+	ut_assert(!blk_is_async(dev_desc));
+
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i / 3;
+	req.start = 4;
+	req.blkcnt = 4;
+	req.buffer = write;
+	req.write = true;
+	ut_assertok(blk_submit(dev_desc, &req));
+	ut_assert(req.done);
+	ut_assertok(blk_poll(dev_desc, &req));
+	ut_asserteq(4, blk_wait(dev_desc, &req));
+
+	req.buffer = read;
+	req.write = false;
+	ut_assertok(blk_submit(dev_desc, &req));
+	ut_asserteq(4, blk_wait(dev_desc, &req));
+	ut_asserteq_mem(write, read, sizeof(read));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Bind host device 0 to a new image file filled with zeroes */
+static int bind_host_image(struct unit_test_state *uts, const char *fname,
+			   int size, struct blk_desc **dev_descp)
+{
+	void *buf;
+
+	buf = calloc(1, size);
+	ut_assertnonnull(buf);
+	ut_assertok(os_write_file(fname, buf, size));
+	free(buf);
+	ut_assertok(host_dev_bind(0, (char *)fname, false));
+	ut_assertok(blk_get_device_by_str("host", "0", dev_descp));
+
+	return 0;
+}
+
+/* Test asynchronous requests on a device which completes them when polled */
+static int dm_test_blk_async_host(struct unit_test_state *uts)
+{
+	static const char fname[] = "blk_async.img";
+	char write[2048], read[2048];
+	struct blk_req req, other;
+	struct blk_desc *dev_desc;
+	int i;
+
+	ut_assertok(bind_host_image(uts, fname, 0x10000, &dev_desc));
+	ut_asserteq(1, blk_get_queue_depth(dev_desc));
+	ut_assert(blk_is_async(dev_desc));
+
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i / 5;
+	req.start = 4;
+	req.blkcnt = 4;
+	req.buffer = write;
+	req.write = true;
+	ut_assertok(blk_submit(dev_desc, &req));
+	ut_assert(!req.done);
+
+	/* Only one request can be in flight */
+	other = req;
+	ut_asserteq(-EBUSY, blk_submit(dev_desc, &other));
+	ut_asserteq(4, blk_wait(dev_desc, &req));
+
+	req.buffer = read;
+	req.write = false;
+	ut_assertok(blk_submit(dev_desc, &req));
+	ut_assert(!req.done);
+	ut_assertok(blk_poll(dev_desc, &req));
+	ut_assert(req.done);
+	ut_asserteq(4, blk_wait(dev_desc, &req));
+	ut_asserteq_mem(write, read, sizeof(read));
+
+	ut_assertok(host_dev_bind(0, NULL, false));
+	os_unlink(fname);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async_host, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_CMD_UNZIP
+/* Test gzwrite() with one and two buffers, and a failed write */
+static int dm_test_blk_gzwrite(struct unit_test_state *uts)
+{
+	static const char fname[] = "blk_gzwrite.img";
+	const ulong size = 0x20000, offset = 0x10000;
+	struct host_block_dev *host_dev;
+	struct blk_desc *dev_desc;
+	unsigned long gz_size;
+	u8 *data, *gz, *read;
+	struct udevice *dev;
+	int i;
+
+	data = malloc(size);
+	ut_assertnonnull(data);
+	for (i = 0; i < size; i++)
+		data[i] = i % 251 ^ i >> 12;
+	gz_size = size;
+	gz = malloc(gz_size);
+	ut_assertnonnull(gz);
+	ut_assertok(gzip(gz, &gz_size, data, size));
+	read = malloc(size);
+	ut_assertnonnull(read);
+
+	/* Several write buffers, so that they are reused */
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	ut_assertok(gzwrite(gz, gz_size, dev_desc, 0x2000, offset, 0));
+	ut_asserteq(size / 512, blk_dread(dev_desc, offset / 512, size / 512,
+					  read));
+	ut_asserteq_mem(data, read, size);
+
+	/*
+	 * Host devices only write a buffer when the request is polled, so
+	 * inflating into a buffer which is still in flight would show here
+	 */
+	ut_assertok(bind_host_image(uts, fname, offset + size, &dev_desc));
+	ut_assert(blk_is_async(dev_desc));
+	ut_assertok(gzwrite(gz, gz_size, dev_desc, 0x2000, offset, 0));
+	memset(read, '\0', size);
+	ut_asserteq(size / 512, blk_dread(dev_desc, offset / 512, size / 512,
+					  read));
+	ut_asserteq_mem(data, read, size);
+	ut_assertok(host_dev_bind(0, NULL, false));
+	os_unlink(fname);
+
+	/* A device without a backing file fails every write */
+	ut_assertok(blk_create_device(gd->dm_root, "sandbox_host_blk", "test",
+				      IF_TYPE_HOST, 1, 512, 0x400, &dev));
+	host_dev = dev_get_plat(dev);
+	host_dev->fd = -1;
+	dev_desc = dev_get_uclass_plat(dev);
+	ut_asserteq(-1, gzwrite(gz, gz_size, dev_desc, 0x2000, offset, 0));
+
+	free(read);
+	free(gz);
+	free(data);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_gzwrite, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+#endif
@@ -431,3 +431,105 @@ static int dm_test_eth_async_ping_reply(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_eth_async_ping_reply, UT_TESTF_SCAN_FDT);
+
+static int sb_with_offload_handler(struct udevice *dev, void *packet,
+				   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct unit_test_state *uts = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+
+	/*
+	 * IP packets are built in the lent buffer and checksummed on send.
+	 * The ping request is built before the ARP request is sent, so it
+	 * only gets here intact if the ARP request did not overwrite it.
+	 */
+	if (ntohs(eth->et_protlen) == PROT_IP) {
+		ut_assert(!priv->tx_copied);
+		ut_assert(ip_checksum_ok(ip, IP_HDR_SIZE));
+	} else {
+		ut_assert(priv->tx_copied);
+	}
+
+	sandbox_eth_arp_req_to_reply(dev, packet, len);
+	sandbox_eth_ping_req_to_reply(dev, packet, len);
+
+	return 0;
+}
+
+/* Test a ping sent while its ARP request is pending, with a lent buffer */
+static int dm_test_eth_offload(struct unit_test_state *uts)
+{
+	net_ping_ip = string_to_ip("1.1.2.2");
+
+	sandbox_eth_set_offload(0, true);
+	sandbox_eth_set_tx_handler(0, sb_with_offload_handler);
+	/* Used by all of the ut_assert macros in the tx_handler */
+	sandbox_eth_set_priv(0, uts);
+
+	env_set("ethact", "eth@10002000");
+	ut_assertok(net_loop(PING));
+	ut_asserteq_str("eth@10002000", env_get("ethact"));
+	ut_asserteq(0, eth_get_features());
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	sandbox_eth_set_offload(0, false);
+
+	return 0;
+}
+
+DM_TEST(dm_test_eth_offload, UT_TESTF_SCAN_FDT);
+
+static int sb_bad_csum_handler(struct udevice *dev, void *packet,
+			       unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int queued = priv->recv_packets;
+	struct ip_udp_hdr *ip;
+
+	sandbox_eth_arp_req_to_reply(dev, packet, len);
+	if (sandbox_eth_ping_req_to_reply(dev, packet, len) ||
+	    priv->recv_packets == queued)
+		return 0;
+
+	/* Corrupt the IPv4 header of the ping reply, then let ping time out */
+	ip = (void *)priv->recv_packet_buffer[queued] + ETHER_HDR_SIZE;
+	ip->ip_sum ^= htons(0x100);
+	sandbox_eth_skip_timeout();
+
+	return 0;
+}
+
+static int _dm_test_eth_offload_bad_csum(struct unit_test_state *uts)
+{
+	/* The mock MAC drops the reply, so net.c does not see it at all */
+	sandbox_eth_set_offload(0, true);
+	ut_asserteq(-ENONET, net_loop(PING));
+
+	/* Without the offload, the IP layer has to drop it */
+	sandbox_eth_set_offload(0, false);
+	ut_asserteq(-ENONET, net_loop(PING));
+
+	return 0;
+}
+
+static int dm_test_eth_offload_bad_csum(struct unit_test_state *uts)
+{
+	int retval;
+
+	net_ping_ip = string_to_ip("1.1.2.2");
+	sandbox_eth_set_tx_handler(0, sb_bad_csum_handler);
+	env_set("ethact", "eth@10002000");
+	env_set("netretry", "no");
+
+	retval = _dm_test_eth_offload_bad_csum(uts);
+
+	env_set("netretry", NULL);
+	sandbox_eth_set_offload(0, false);
+	sandbox_eth_set_tx_handler(0, NULL);
+
+	return retval;
+}
+
+DM_TEST(dm_test_eth_offload_bad_csum, UT_TESTF_SCAN_FDT);
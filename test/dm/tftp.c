@@ -0,0 +1,382 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for TFTP windows with lost and reordered blocks
+ *
+ * A mock server is attached to the sandbox Ethernet device. It answers the
+ * read request and then sends one window of blocks for each ACK, leaving out
+ * or swapping blocks as asked by the test.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <env.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <net.h>
+#include <time.h>
+#include <vsprintf.h>
+#include <asm/eth.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TFTP_RRQ	1
+#define TFTP_DATA	3
+#define TFTP_ACK	4
+#define TFTP_OACK	6
+
+/* Port the mock server sends from once the read request is answered */
+#define TFTP_MOCK_PORT	7000
+
+/* An ACK this long after the window went out means the client timed out */
+#define TFTP_MOCK_STALL_MS	1000
+
+#define TFTP_TEST_BLKSIZE	16
+
+/**
+ * struct tftp_mock - state of the mock TFTP server
+ *
+ * Block numbers are counted from 1 without wrapping at 16 bits.
+ *
+ * @data: file contents
+ * @size: file size in bytes
+ * @blocks: number of DATA blocks, including the final short one
+ * @blksize: block size asked for in the read request, up to
+ *	TFTP_TEST_BLKSIZE
+ * @windowsize: window size asked for in the read request, 1 if none
+ * @drop: block to leave out the first time it is sent, 0 for none
+ * @swap: block to send after the one following it, 0 for none
+ * @acked: highest block acknowledged by the client
+ * @sent_at: time the last window was sent
+ * @stalls: number of ACKs which only came after a timeout
+ * @client_port: port the client sends from
+ */
+struct tftp_mock {
+	uchar *data;
+	ulong size;
+	ulong blocks;
+	int blksize;
+	int windowsize;
+	ulong drop;
+	ulong swap;
+	ulong acked;
+	ulong sent_at;
+	int stalls;
+	ushort client_port;
+};
+
+static void tftp_mock_queue(struct udevice *dev, struct tftp_mock *mock,
+			    const void *tftp, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth;
+	struct ip_udp_hdr *ip;
+
+	/* Frames which do not fit are lost, as with a real receive ring */
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, net_ethaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	ip = (void *)eth + ETHER_HDR_SIZE;
+	net_set_ip_header((uchar *)ip, net_ip, priv->fake_host_ipaddr,
+			  IP_UDP_HDR_SIZE + len, IPPROTO_UDP);
+	ip->udp_src = htons(TFTP_MOCK_PORT);
+	ip->udp_dst = htons(mock->client_port);
+	ip->udp_len = htons(UDP_HDR_SIZE + len);
+	ip->udp_xsum = 0;
+	memcpy((void *)ip + IP_UDP_HDR_SIZE, tftp, len);
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len;
+	++priv->recv_packets;
+}
+
+/*
+ * Check whether a block still waits in the receive ring. The first frame is
+ * the one the client is handling, so it does not count.
+ */
+static bool tftp_mock_pending(struct udevice *dev, ulong block)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	__be16 *s;
+	int i;
+
+	for (i = 1; i < priv->recv_packets; i++) {
+		s = (void *)priv->recv_packet_buffer[i] + ETHER_HDR_SIZE +
+			IP_UDP_HDR_SIZE;
+		if (ntohs(s[0]) == TFTP_DATA && ntohs(s[1]) == (ushort)block)
+			return true;
+	}
+
+	return false;
+}
+
+static void tftp_mock_send_block(struct udevice *dev, struct tftp_mock *mock,
+				 ulong block)
+{
+	uchar pkt[4 + TFTP_TEST_BLKSIZE];
+	ulong offset = (block - 1) * mock->blksize;
+	int len = min(mock->size - offset, (ulong)mock->blksize);
+	__be16 *s = (__be16 *)pkt;
+
+	/* Sending it again would only fill up the ring */
+	if (tftp_mock_pending(dev, block))
+		return;
+
+	s[0] = htons(TFTP_DATA);
+	s[1] = htons((ushort)block);
+	memcpy(pkt + 4, mock->data + offset, len);
+	tftp_mock_queue(dev, mock, pkt, 4 + len);
+}
+
+static void tftp_mock_send_window(struct udevice *dev, struct tftp_mock *mock,
+				  ulong first)
+{
+	ulong last = min(first + mock->windowsize - 1, mock->blocks);
+	ulong block;
+
+	for (block = first; block <= last; block++) {
+		if (block == mock->drop) {
+			mock->drop = 0;
+			continue;
+		}
+		if (block == mock->swap && block < last) {
+			mock->swap = 0;
+			tftp_mock_send_block(dev, mock, block + 1);
+			tftp_mock_send_block(dev, mock, block);
+			block++;
+			continue;
+		}
+		tftp_mock_send_block(dev, mock, block);
+	}
+	mock->sent_at = get_timer(0);
+}
+
+static void tftp_mock_rrq(struct udevice *dev, struct tftp_mock *mock,
+			  const char *opt, int len)
+{
+	char oack[64];
+	char *p = oack;
+	const char *end = opt + len;
+
+	mock->blksize = TFTP_TEST_BLKSIZE;
+	mock->windowsize = 1;
+
+	/* Skip the file name and mode, then pick out the options we need */
+	opt += strlen(opt) + 1;
+	opt += strlen(opt) + 1;
+	while (opt < end && opt + strlen(opt) + 1 < end) {
+		const char *val = opt + strlen(opt) + 1;
+
+		if (!strcmp(opt, "blksize"))
+			mock->blksize = min(dectoul(val, NULL),
+					    (ulong)TFTP_TEST_BLKSIZE);
+		else if (!strcmp(opt, "windowsize"))
+			mock->windowsize = dectoul(val, NULL);
+		opt = val + strlen(val) + 1;
+	}
+	mock->blocks = mock->size / mock->blksize + 1;
+	mock->acked = 0;
+
+	*(__be16 *)p = htons(TFTP_OACK);
+	p += 2;
+	p += sprintf(p, "blksize%c%d%c", 0, mock->blksize, 0);
+	if (mock->windowsize > 1)
+		p += sprintf(p, "windowsize%c%d%c", 0, mock->windowsize, 0);
+	tftp_mock_queue(dev, mock, oack, p - oack);
+}
+
+static int sb_tftp_handler(struct udevice *dev, void *packet,
+			   unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct tftp_mock *mock = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	__be16 *s = packet + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	ushort ahead;
+	ulong block;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return 0;
+
+	mock->client_port = ntohs(ip->udp_src);
+	switch (ntohs(s[0])) {
+	case TFTP_RRQ:
+		tftp_mock_rrq(dev, mock, (char *)(s + 1),
+			      len - ETHER_HDR_SIZE - IP_UDP_HDR_SIZE - 2);
+		break;
+	case TFTP_ACK:
+		ahead = ntohs(s[1]) - (ushort)mock->acked;
+		if (ahead > mock->windowsize)
+			break;
+		block = mock->acked + ahead;
+		if (block && get_timer(mock->sent_at) >= TFTP_MOCK_STALL_MS)
+			mock->stalls++;
+		mock->acked = block;
+		if (block < mock->blocks)
+			tftp_mock_send_window(dev, mock, block + 1);
+		break;
+	}
+
+	return 0;
+}
+
+/* Load the file from the mock server and check what arrived */
+static int tftp_mock_get(struct unit_test_state *uts, struct tftp_mock *mock)
+{
+	void *buf;
+
+	mock->stalls = 0;
+	ut_asserteq(mock->size, net_loop(TFTPGET));
+	buf = map_sysmem(image_load_addr, mock->size);
+	ut_asserteq_mem(mock->data, buf, mock->size);
+	unmap_sysmem(buf);
+	ut_asserteq(mock->blocks, mock->acked);
+	ut_asserteq(0, mock->stalls);
+
+	return 0;
+}
+
+/*
+ * Load the file without losing anything until the window asked for is back
+ * at tftpwindowsize, after earlier lossy transfers made it smaller
+ */
+static int tftp_mock_settle(struct unit_test_state *uts, struct tftp_mock *mock,
+			    int windowsize)
+{
+	int i = 0;
+
+	do {
+		ut_assertok(tftp_mock_get(uts, mock));
+	} while (mock->windowsize != windowsize && ++i < 4);
+	ut_asserteq(windowsize, mock->windowsize);
+
+	return 0;
+}
+
+static int tftp_mock_setup(struct tftp_mock *mock, ulong size)
+{
+	ulong i;
+
+	memset(mock, '\0', sizeof(*mock));
+	mock->data = malloc(size);
+	if (!mock->data)
+		return -ENOMEM;
+	for (i = 0; i < size; i++)
+		mock->data[i] = i * 7 + (i >> 8);
+	mock->size = size;
+
+	sandbox_eth_set_tx_handler(0, sb_tftp_handler);
+	sandbox_eth_set_priv(0, mock);
+	env_set("ethact", "eth@10002000");
+	env_set("serverip", "1.1.2.2");
+	env_set("bootfile", "mock.bin");
+	env_set_ulong("tftpblocksize", TFTP_TEST_BLKSIZE);
+
+	return 0;
+}
+
+static void tftp_mock_cleanup(struct tftp_mock *mock)
+{
+	env_set("tftpwindowsize", NULL);
+	env_set("tftpblocksize", NULL);
+	env_set("bootfile", NULL);
+	env_set("serverip", NULL);
+	env_set("ethact", NULL);
+	sandbox_eth_set_tx_handler(0, NULL);
+	free(mock->data);
+}
+
+static int _dm_test_eth_tftp_window(struct unit_test_state *uts,
+				    struct tftp_mock *mock)
+{
+	env_set("tftpwindowsize", "2");
+	ut_assertok(tftp_mock_settle(uts, mock, 2));
+
+	/*
+	 * The block after a lost one ends the window, and must be followed
+	 * by a NACK without waiting for more blocks
+	 */
+	mock->drop = 101;
+	ut_assertok(tftp_mock_get(uts, mock));
+	ut_asserteq(0, mock->drop);
+
+	/* Both blocks arrive, but the second first, across the map wrap */
+	ut_assertok(tftp_mock_settle(uts, mock, 2));
+	mock->swap = 255;
+	ut_assertok(tftp_mock_get(uts, mock));
+	ut_asserteq(0, mock->swap);
+
+	/*
+	 * Windows of three leave two blocks for the last one; the short
+	 * final block overtaking the one before must be NACKed too
+	 */
+	env_set("tftpwindowsize", "3");
+	ut_assertok(tftp_mock_settle(uts, mock, 3));
+	ut_asserteq(2, mock->blocks % 3);
+	mock->drop = mock->blocks - 1;
+	ut_assertok(tftp_mock_get(uts, mock));
+	ut_asserteq(0, mock->drop);
+
+	return 0;
+}
+
+static int dm_test_eth_tftp_window(struct unit_test_state *uts)
+{
+	struct tftp_mock mock;
+	int ret;
+
+	/* 302 blocks, so that the map of blocks stored ahead wraps */
+	ut_assertok(tftp_mock_setup(&mock, 301 * TFTP_TEST_BLKSIZE + 5));
+	ret = _dm_test_eth_tftp_window(uts, &mock);
+	tftp_mock_cleanup(&mock);
+
+	return ret;
+}
+DM_TEST(dm_test_eth_tftp_window, UT_TESTF_SCAN_FDT);
+
+static int _dm_test_eth_tftp_adapt(struct unit_test_state *uts,
+				   struct tftp_mock *mock)
+{
+	env_set("tftpwindowsize", "2");
+	ut_assertok(tftp_mock_settle(uts, mock, 2));
+
+	/* A lost block halves the window asked for next time */
+	mock->drop = 3;
+	ut_assertok(tftp_mock_get(uts, mock));
+	ut_asserteq(0, mock->drop);
+	ut_assertok(tftp_mock_get(uts, mock));
+	ut_asserteq(1, mock->windowsize);
+
+	/* and it grows back, up to tftpwindowsize, without loss */
+	ut_assertok(tftp_mock_get(uts, mock));
+	ut_asserteq(2, mock->windowsize);
+	ut_assertok(tftp_mock_get(uts, mock));
+	ut_asserteq(2, mock->windowsize);
+
+	return 0;
+}
+
+static int dm_test_eth_tftp_adapt(struct unit_test_state *uts)
+{
+	struct tftp_mock mock;
+	int ret;
+
+	if (!IS_ENABLED(CONFIG_TFTP_ADAPTIVE_WINDOW))
+		return 0;
+
+	ut_assertok(tftp_mock_setup(&mock, 3 * TFTP_TEST_BLKSIZE + 5));
+	ret = _dm_test_eth_tftp_adapt(uts, &mock);
+	tftp_mock_cleanup(&mock);
+
+	return ret;
+}
+DM_TEST(dm_test_eth_tftp_adapt, UT_TESTF_SCAN_FDT);
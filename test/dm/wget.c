@@ -0,0 +1,401 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for TCP, through HTTP downloads with wget
+ *
+ * A mock HTTP server is attached to the sandbox Ethernet device. It accepts
+ * the connection, answers the request in segments of TCP_MOCK_SEG bytes and
+ * goes back to the first unacknowledged one on a duplicate ACK. The tests
+ * have it leave out, swap or reset segments.
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <env.h>
+#include <image.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/eth.h>
+#include <asm/unaligned.h>
+#include <dm/test.h>
+#include <net/tcp.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Initial sequence number of the mock server */
+#define TCP_MOCK_ISS	0x12345678
+/* Payload of each segment sent by the mock server */
+#define TCP_MOCK_SEG	100
+/* Segments sent for each ACK */
+#define TCP_MOCK_BURST	2
+
+#define WGET_TEST_SIZE	2000
+
+/**
+ * struct tcp_mock - state of the mock HTTP server
+ *
+ * Offsets are in the stream sent by the server, which holds the response
+ * header and then the file. Segments are counted from 1.
+ *
+ * @stream: response header and file
+ * @total: length of @stream
+ * @body: offset of the file in @stream
+ * @fin: close the connection after the file, without a Content-Length
+ * @rst: reset the connection instead of answering the request; the first
+ *	reset is outside the window and must be ignored
+ * @drop: segment to leave out the first time it is sent, 0 for none
+ * @swap: segment to send after the one following it, 0 for none
+ * @una: oldest offset not acknowledged by the client
+ * @snd_nxt: next offset to send
+ * @dup_acks: number of duplicate ACKs received
+ * @syn_mss: MSS option in the client's SYN, 0 if none
+ * @connected: the client acknowledged our SYN
+ * @requests: number of times the request was received
+ * @request: start of the request
+ * @client_nxt: next sequence number expected from the client
+ * @client_port: port the client sends from
+ * @server_port: port the client connects to
+ */
+struct tcp_mock {
+	uchar *stream;
+	ulong total;
+	ulong body;
+	bool fin;
+	bool rst;
+	ulong drop;
+	ulong swap;
+	ulong una;
+	ulong snd_nxt;
+	int dup_acks;
+	int syn_mss;
+	bool connected;
+	int requests;
+	char request[64];
+	u32 client_nxt;
+	ushort client_port;
+	ushort server_port;
+};
+
+static void tcp_mock_queue(struct udevice *dev, struct tcp_mock *mock,
+			   u8 flags, u32 seq, const void *data, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth;
+	struct ip_tcp_hdr *ip;
+	u16 pseudo[6];
+	uint sum;
+
+	/* Frames which do not fit are lost, as with a real receive ring */
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	eth = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth->et_dest, net_ethaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	ip = (void *)eth + ETHER_HDR_SIZE;
+	net_set_ip_header((uchar *)ip, net_ip, priv->fake_host_ipaddr,
+			  IP_TCP_HDR_SIZE + len, IPPROTO_TCP);
+	ip->tcp_src = htons(mock->server_port);
+	ip->tcp_dst = htons(mock->client_port);
+	ip->tcp_seq = htonl(seq);
+	ip->tcp_ack = htonl(mock->client_nxt);
+	ip->tcp_hlen = (TCP_HDR_SIZE / 4) << 4;
+	ip->tcp_flags = flags;
+	ip->tcp_win = htons(0xffff);
+	ip->tcp_xsum = 0;
+	ip->tcp_urg = 0;
+	memcpy((void *)ip + IP_TCP_HDR_SIZE, data, len);
+
+	memcpy(pseudo, &ip->ip_src, 2 * sizeof(struct in_addr));
+	pseudo[4] = htons(IPPROTO_TCP);
+	pseudo[5] = htons(TCP_HDR_SIZE + len);
+	sum = compute_ip_checksum(pseudo, sizeof(pseudo));
+	sum = add_ip_checksums(sizeof(pseudo), sum,
+			       compute_ip_checksum(&ip->tcp_src,
+						   TCP_HDR_SIZE + len));
+	ip->tcp_xsum = sum;
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_TCP_HDR_SIZE + len;
+	++priv->recv_packets;
+}
+
+/*
+ * Check whether a segment still waits in the receive ring. The first frame
+ * is the one the client is handling, so it does not count.
+ */
+static bool tcp_mock_pending(struct udevice *dev, u32 seq)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ip_tcp_hdr *ip;
+	int i;
+
+	for (i = 1; i < priv->recv_packets; i++) {
+		ip = (void *)priv->recv_packet_buffer[i] + ETHER_HDR_SIZE;
+		if (ip->ip_p == IPPROTO_TCP && ntohl(ip->tcp_seq) == seq)
+			return true;
+	}
+
+	return false;
+}
+
+/* Send the segment at @offset and return the offset following it */
+static ulong tcp_mock_send_seg(struct udevice *dev, struct tcp_mock *mock,
+			       ulong offset)
+{
+	int len = min(mock->total - offset, (ulong)TCP_MOCK_SEG);
+	u32 seq = TCP_MOCK_ISS + 1 + offset;
+	u8 flags = TCP_ACK | TCP_PUSH;
+
+	if (mock->fin && offset + len == mock->total)
+		flags |= TCP_FIN;
+
+	/* Sending it again would only fill up the ring */
+	if (!tcp_mock_pending(dev, seq))
+		tcp_mock_queue(dev, mock, flags, seq, mock->stream + offset,
+			       len);
+
+	return offset + len;
+}
+
+static void tcp_mock_send(struct udevice *dev, struct tcp_mock *mock)
+{
+	ulong seg, next;
+	int i;
+
+	/* Nothing is sent before the request, nor after a reset */
+	if (!mock->requests || mock->rst)
+		return;
+
+	for (i = 0; i < TCP_MOCK_BURST && mock->snd_nxt < mock->total; i++) {
+		seg = mock->snd_nxt / TCP_MOCK_SEG + 1;
+		next = min(mock->snd_nxt + TCP_MOCK_SEG, mock->total);
+		if (seg == mock->drop) {
+			mock->drop = 0;
+			mock->snd_nxt = next;
+			continue;
+		}
+		if (seg == mock->swap && next < mock->total) {
+			mock->swap = 0;
+			mock->snd_nxt = tcp_mock_send_seg(dev, mock, next);
+			tcp_mock_send_seg(dev, mock, next - TCP_MOCK_SEG);
+			i++;
+			continue;
+		}
+		mock->snd_nxt = tcp_mock_send_seg(dev, mock, mock->snd_nxt);
+	}
+}
+
+static void tcp_mock_request(struct udevice *dev, struct tcp_mock *mock,
+			     u32 seq, const char *data, int len)
+{
+	int n = min(len, (int)sizeof(mock->request) - 1);
+
+	/* The client sends the request again until it is acknowledged */
+	if (seq == mock->client_nxt) {
+		memcpy(mock->request, data, n);
+		mock->request[n] = '\0';
+		mock->client_nxt += len;
+	} else if (seq + len != mock->client_nxt) {
+		return;
+	}
+	mock->requests++;
+
+	if (mock->rst) {
+		if (mock->requests == 1)
+			seq = TCP_MOCK_ISS + 1 + 0x40000000;
+		else
+			seq = TCP_MOCK_ISS + 1;
+		tcp_mock_queue(dev, mock, TCP_RST | TCP_ACK, seq, NULL, 0);
+		return;
+	}
+
+	tcp_mock_send(dev, mock);
+}
+
+static int sb_tcp_handler(struct udevice *dev, void *packet,
+			  unsigned int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct tcp_mock *mock = priv->priv;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *ip = packet + ETHER_HDR_SIZE;
+	uchar *opt = (uchar *)ip + IP_TCP_HDR_SIZE;
+	int hlen, dlen;
+	u32 seq, ack;
+
+	if (!sandbox_eth_arp_req_to_reply(dev, packet, len))
+		return 0;
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_TCP)
+		return 0;
+
+	hlen = (ip->tcp_hlen >> 4) * 4;
+	dlen = ntohs(ip->ip_len) - IP_HDR_SIZE - hlen;
+	seq = ntohl(ip->tcp_seq);
+
+	if (ip->tcp_flags & TCP_SYN) {
+		if (hlen >= TCP_HDR_SIZE + 4 && opt[0] == TCP_OPT_MSS)
+			mock->syn_mss = get_unaligned_be16(opt + 2);
+		mock->client_port = ntohs(ip->tcp_src);
+		mock->server_port = ntohs(ip->tcp_dst);
+		mock->client_nxt = seq + 1;
+		mock->una = 0;
+		mock->snd_nxt = 0;
+		tcp_mock_queue(dev, mock, TCP_SYN | TCP_ACK, TCP_MOCK_ISS,
+			       NULL, 0);
+		return 0;
+	}
+	if (!(ip->tcp_flags & TCP_ACK))
+		return 0;
+
+	ack = ntohl(ip->tcp_ack) - TCP_MOCK_ISS - 1;
+	if (!ack)
+		mock->connected = true;
+	if (dlen > 0) {
+		tcp_mock_request(dev, mock, seq,
+				 (char *)ip + IP_HDR_SIZE + hlen, dlen);
+		return 0;
+	}
+	/* The client closes once it has the file */
+	if (ip->tcp_flags & TCP_FIN)
+		return 0;
+
+	if ((s32)(ack - mock->una) > 0) {
+		mock->una = min((ulong)ack, mock->total);
+	} else if (ack == mock->una && mock->una < mock->snd_nxt) {
+		mock->dup_acks++;
+		mock->snd_nxt = mock->una;
+	}
+	tcp_mock_send(dev, mock);
+
+	return 0;
+}
+
+static int tcp_mock_setup(struct tcp_mock *mock, ulong size, bool fin)
+{
+	char hdr[80];
+	ulong i;
+
+	memset(mock, '\0', sizeof(*mock));
+	mock->body = sprintf(hdr, "HTTP/1.1 200 OK\r\n");
+	if (!fin)
+		mock->body += sprintf(hdr + mock->body,
+				      "Content-Length: %lu\r\n", size);
+	mock->body += sprintf(hdr + mock->body, "\r\n");
+	mock->total = mock->body + size;
+	mock->stream = malloc(mock->total);
+	if (!mock->stream)
+		return -ENOMEM;
+	memcpy(mock->stream, hdr, mock->body);
+	for (i = 0; i < size; i++)
+		mock->stream[mock->body + i] = i * 7 + (i >> 8);
+	mock->fin = fin;
+
+	sandbox_eth_set_tx_handler(0, sb_tcp_handler);
+	sandbox_eth_set_priv(0, mock);
+	env_set("ethact", "eth@10002000");
+	env_set("serverip", "1.1.2.2");
+	env_set("bootfile", "mock.bin");
+
+	return 0;
+}
+
+static void tcp_mock_cleanup(struct tcp_mock *mock)
+{
+	env_set("bootfile", NULL);
+	env_set("serverip", NULL);
+	env_set("ethact", NULL);
+	sandbox_eth_set_tx_handler(0, NULL);
+	free(mock->stream);
+}
+
+/* Download the file from the mock server and check what arrived */
+static int tcp_mock_get(struct unit_test_state *uts, struct tcp_mock *mock)
+{
+	ulong size = mock->total - mock->body;
+	void *buf;
+
+	mock->syn_mss = 0;
+	mock->connected = false;
+	mock->requests = 0;
+	mock->dup_acks = 0;
+	ut_asserteq(size, net_loop(WGET));
+	buf = map_sysmem(image_load_addr, size);
+	ut_asserteq_mem(mock->stream + mock->body, buf, size);
+	unmap_sysmem(buf);
+
+	ut_asserteq(TCP_MSS, mock->syn_mss);
+	ut_assert(mock->connected);
+	ut_asserteq(1, mock->requests);
+	ut_asserteq_strn("GET /mock.bin HTTP/1.1\r\n", mock->request);
+
+	return 0;
+}
+
+static int _dm_test_eth_wget(struct unit_test_state *uts,
+			     struct tcp_mock *mock)
+{
+	ut_assertok(tcp_mock_get(uts, mock));
+	ut_asserteq(0, mock->dup_acks);
+
+	/* A segment arriving before the one in front of it is kept */
+	mock->swap = 9;
+	ut_assertok(tcp_mock_get(uts, mock));
+	ut_asserteq(0, mock->swap);
+	ut_assert(mock->dup_acks > 0);
+
+	/* A lost segment is sent again on the duplicate ACK */
+	mock->drop = 7;
+	ut_assertok(tcp_mock_get(uts, mock));
+	ut_asserteq(0, mock->drop);
+	ut_assert(mock->dup_acks > 0);
+
+	return 0;
+}
+
+static int dm_test_eth_wget(struct unit_test_state *uts)
+{
+	struct tcp_mock mock;
+	int ret;
+
+	ut_assertok(tcp_mock_setup(&mock, WGET_TEST_SIZE, false));
+	ret = _dm_test_eth_wget(uts, &mock);
+	tcp_mock_cleanup(&mock);
+
+	return ret;
+}
+DM_TEST(dm_test_eth_wget, UT_TESTF_SCAN_FDT);
+
+/* Without a Content-Length the end of the file is where the server closes */
+static int dm_test_eth_wget_fin(struct unit_test_state *uts)
+{
+	struct tcp_mock mock;
+	int ret;
+
+	ut_assertok(tcp_mock_setup(&mock, WGET_TEST_SIZE + 55, true));
+	ret = tcp_mock_get(uts, &mock);
+	tcp_mock_cleanup(&mock);
+
+	return ret;
+}
+DM_TEST(dm_test_eth_wget_fin, UT_TESTF_SCAN_FDT);
+
+static int dm_test_eth_wget_rst(struct unit_test_state *uts)
+{
+	struct tcp_mock mock;
+	int ret;
+
+	ut_assertok(tcp_mock_setup(&mock, WGET_TEST_SIZE, false));
+	mock.rst = true;
+	ret = net_loop(WGET);
+	tcp_mock_cleanup(&mock);
+
+	ut_asserteq(-ENONET, ret);
+	/* The reset outside the window made no difference */
+	ut_asserteq(2, mock.requests);
+
+	return 0;
+}
+DM_TEST(dm_test_eth_wget_rst, UT_TESTF_SCAN_FDT);
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests and benchmark for the CRC32 and CRC32C implementations
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <time.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+#include <linux/math64.h>
+
+#define CRC32_POLY_LE		0xedb88320
+/* Size of the buffer checksummed by the benchmark */
+#define CRC_BENCH_SIZE		(1 << 20)
+#define CRC_BENCH_LOOPS		16
+
+static const char check_str[] = "123456789";
+
+/* Bit at a time reference, without the final inversion */
+static u32 crc_ref(u32 crc, const u8 *p, uint len, u32 poly)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (crc & 1 ? poly : 0);
+	}
+
+	return crc;
+}
+
+static void crc_fill(u8 *buf, uint len)
+{
+	u32 x = 0x12345678;
+	uint i;
+
+	for (i = 0; i < len; i++) {
+		x = x * 1103515245 + 12345;
+		buf[i] = x >> 16;
+	}
+}
+
+/* Check crc32() against the reference at every alignment and length */
+static int lib_test_crc32(struct unit_test_state *uts)
+{
+	u8 buf[160];
+	uint ofs, len;
+
+	ut_asserteq(0xcbf43926, crc32(0, (const u8 *)check_str,
+				      strlen(check_str)));
+	ut_asserteq(0, crc32(0, NULL, 0));
+
+	crc_fill(buf, sizeof(buf));
+	for (ofs = 0; ofs < 8; ofs++) {
+		for (len = 0; len <= sizeof(buf) - 8; len++) {
+			ut_asserteq(crc_ref(~0U, buf + ofs, len,
+					    CRC32_POLY_LE),
+				    crc32_no_comp(~0U, buf + ofs, len));
+		}
+	}
+
+	/* Chaining must give the same result as one call */
+	ut_asserteq(crc32(0, buf, sizeof(buf)),
+		    crc32(crc32(0, buf, 13), buf + 13, sizeof(buf) - 13));
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32, 0);
+
+#ifdef CONFIG_CRC32C
+/*
+ * Check crc32c_cal() and crc32c_castagnoli() against the reference at every
+ * alignment and length
+ */
+static int lib_test_crc32c(struct unit_test_state *uts)
+{
+	u32 table[256];
+	u8 buf[160];
+	uint ofs, len;
+
+	crc32c_init(table, CRC32C_POLY_LE);
+	ut_asserteq(0xe3069283, ~crc32c_cal(~0U, check_str, strlen(check_str),
+					    table));
+
+	crc_fill(buf, sizeof(buf));
+	for (ofs = 0; ofs < 8; ofs++) {
+		for (len = 0; len <= sizeof(buf) - 8; len++) {
+			ut_asserteq(crc_ref(~0U, buf + ofs, len,
+					    CRC32C_POLY_LE),
+				    crc32c_cal(~0U, (char *)buf + ofs, len,
+					       table));
+			ut_asserteq(crc_ref(~0U, buf + ofs, len,
+					    CRC32C_POLY_LE),
+				    crc32c_castagnoli(~0U, (char *)buf + ofs,
+						      len, table));
+		}
+	}
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32c, 0);
+#endif
+
+/* Report the throughput; this only fails if memory is short */
+static int lib_test_crc32_bench(struct unit_test_state *uts)
+{
+	ulong start, time;
+	u32 crc = 0;
+	u8 *buf;
+	int i;
+
+	buf = malloc(CRC_BENCH_SIZE);
+	ut_assertnonnull(buf);
+	crc_fill(buf, CRC_BENCH_SIZE);
+
+	start = timer_get_us();
+	for (i = 0; i < CRC_BENCH_LOOPS; i++)
+		crc = crc32(crc, buf, CRC_BENCH_SIZE);
+	time = max(timer_get_us() - start, 1UL);
+	/* Bytes per microsecond are MB/s */
+	printf("crc32: %llu MB/s (%08x)\n",
+	       div_u64((u64)CRC_BENCH_SIZE * CRC_BENCH_LOOPS, time), crc);
+
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_crc32_bench, 0);
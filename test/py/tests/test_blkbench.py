@@ -0,0 +1,56 @@
+# SPDX-License-Identifier: GPL-2.0
+
+# Test the blkbench command on a sandbox host file.
+
+import os
+import pytest
+
+@pytest.fixture(scope='function')
+def bench_disk(u_boot_console):
+    """Bind a 4 MB zero-filled file as host device 0."""
+
+    path = u_boot_console.config.result_dir + '/test_blkbench.img'
+    fd = os.open(path, os.O_RDWR | os.O_CREAT)
+    os.ftruncate(fd, 4194304)
+    os.close(fd)
+    u_boot_console.run_command('host bind 0 %s' % path)
+    yield path
+    os.remove(path)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_blk_bench')
+def test_blkbench_read(u_boot_console, bench_disk):
+    """Run the read patterns at every size up to 64 KiB."""
+
+    output = u_boot_console.run_command(
+        'blkbench host 0 ${loadaddr} 0x10000; echo rc:$?')
+    assert 'rc:0' in output
+    for pattern in ('seqread', 'randread'):
+        sizes = [line.split()[1] for line in output.splitlines()
+                 if line.startswith(pattern)]
+        assert sizes == ['4', '16', '64']
+    assert 'seqwrite' not in output
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_blk_bench')
+def test_blkbench_write(u_boot_console, bench_disk):
+    """Write patterns overwrite the device with the buffer."""
+
+    u_boot_console.run_command('mw.b ${loadaddr} 0xa5 0x4000')
+    output = u_boot_console.run_command(
+        'blkbench host 0 ${loadaddr} 0x4000 write; echo rc:$?')
+    assert 'rc:0' in output
+    assert 'seqwrite' in output
+    assert 'randwrite' in output
+    with open(bench_disk, 'rb') as fd:
+        assert fd.read(4096) == b'\xa5' * 4096
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_blk_bench')
+def test_blkbench_bad_size(u_boot_console, bench_disk):
+    """Transfer sizes below 4 KiB are refused."""
+
+    output = u_boot_console.run_command(
+        'blkbench host 0 ${loadaddr} 0x200; echo rc:$?')
+    assert 'must be a multiple' in output
+    assert 'rc:1' in output
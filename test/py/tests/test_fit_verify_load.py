@@ -0,0 +1,125 @@
+# SPDX-License-Identifier:	GPL-2.0+
+#
+# Check that FIT images are verified while they are copied to their load
+# address
+
+import os
+import pytest
+import zlib
+import u_boot_utils as util
+
+ITS = '''
+/dts-v1/;
+
+/ {
+        description = "FIT verify-on-load test";
+        #address-cells = <1>;
+
+        images {
+                kernel-1 {
+                        data = /incbin/("%(kernel)s");
+                        type = "kernel";
+                        arch = "sandbox";
+                        os = "linux";
+                        compression = "none";
+                        load = <0x40000>;
+                        entry = <0x40000>;
+                };
+                ramdisk-1 {
+                        data = /incbin/("%(ramdisk)s");
+                        type = "ramdisk";
+                        arch = "sandbox";
+                        os = "linux";
+                        compression = "none";
+                        load = <%(ramdisk_addr)#x>;
+                        hash-1 {
+                                algo = "sha256";
+                        };
+                        hash-2 {
+                                algo = "crc32";
+                        };
+                };
+        };
+        configurations {
+                default = "conf-1";
+                conf-1 {
+                        kernel = "kernel-1";
+                        ramdisk = "ramdisk-1";
+                };
+        };
+};
+'''
+
+FIT_ADDR = 0x1000000
+RAMDISK_ADDR = 0x2000000
+
+def load_ramdisk(cons, fit):
+    """Load a FIT and run bootm start on it, which loads the ramdisk
+
+    Args:
+        cons: U-Boot console
+        fit: Filename of the FIT
+
+    Returns:
+        Output of the commands, from the ramdisk load on
+    """
+    output = cons.run_command_list([
+        'setenv verify y',
+        'host load hostfs 0 %x %s' % (FIT_ADDR, fit),
+        'bootm start %x' % FIT_ADDR])
+    output = '\n'.join(output)
+    assert 'Loading ramdisk from FIT' in output
+    return output.split('Loading ramdisk from FIT', 1)[1]
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('fit_verify_on_load')
+@pytest.mark.requiredtool('dtc')
+def test_fit_verify_load(u_boot_console):
+    """Test that a ramdisk is verified as it is loaded, and that a corrupted
+    one is refused without any of its hashes being reported as good"""
+    cons = u_boot_console
+    mkimage = cons.config.build_dir + '/tools/mkimage'
+    tmpdir = cons.config.result_dir + '/'
+    kernel = tmpdir + 'verify-load-kernel.bin'
+    ramdisk = tmpdir + 'verify-load-ramdisk.bin'
+    its = tmpdir + 'verify-load.its'
+    fit = tmpdir + 'verify-load.fit'
+    bad_fit = tmpdir + 'verify-load-bad.fit'
+
+    with open(kernel, 'wb') as fd:
+        fd.write(os.urandom(0x1000))
+    # Several CHUNKSZ chunks, so the copy is hashed a piece at a time
+    ramdisk_data = os.urandom(0x32123)
+    with open(ramdisk, 'wb') as fd:
+        fd.write(ramdisk_data)
+    with open(its, 'w') as fd:
+        fd.write(ITS % {'kernel': kernel, 'ramdisk': ramdisk,
+                        'ramdisk_addr': RAMDISK_ADDR})
+    util.run_and_log(cons, [mkimage, '-f', its, fit])
+
+    # Flip a bit in the last chunk of the ramdisk data
+    with open(fit, 'rb') as fd:
+        data = bytearray(fd.read())
+    pos = data.find(ramdisk_data)
+    assert pos > 0
+    data[pos + len(ramdisk_data) - 0x10] ^= 0x01
+    with open(bad_fit, 'wb') as fd:
+        fd.write(data)
+
+    # The good image is loaded and both hashes are checked over the copy
+    output = load_ramdisk(cons, fit)
+    assert 'Verifying Hash Integrity ... sha256+ crc32+ OK' in output
+    assert 'Ramdisk image is corrupt or invalid' not in output
+    output = cons.run_command('crc32 %x %x' % (RAMDISK_ADDR,
+                                               len(ramdisk_data)))
+    assert '%08x' % zlib.crc32(ramdisk_data) in output
+
+    # The bad one is refused, and no hash or image is reported as verified
+    output = load_ramdisk(cons, bad_fit)
+    assert ("Bad hash value for 'hash-1' hash node in 'ramdisk-1' image node"
+            in output)
+    assert 'Bad Data Hash' in output
+    assert 'Ramdisk image is corrupt or invalid' in output
+    assert '+ ' not in output
+    assert ' OK' not in output
+    assert cons.run_command('echo $?') == '1'
@@ -0,0 +1,109 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: btrfs read test
+
+"""
+This test reads files from btrfs images, with and without compression, and
+checks whole reads and reads which start inside an extent or a hole.
+"""
+
+import hashlib
+import os
+import pytest
+from subprocess import call, check_call, CalledProcessError
+
+ADDR = 0x01000000
+
+def make_files(src_dir):
+    """Create the files to put in the image.
+
+    - random: incompressible data made of several extents
+    - text: compressible data, split in 128KiB extents when compressed
+    - sparse: data with a hole in the middle
+    - small: short enough to be stored inline in the tree
+
+    Args:
+        src_dir: Directory to create.
+
+    Return:
+        A dict of file names and their contents.
+    """
+    files = {}
+    files['random'] = os.urandom(0x300000 + 0x321)
+    files['text'] = b''.join([b'line %08d of the compressible file\n' % i
+                              for i in range(40000)])
+    files['sparse'] = os.urandom(0x5000) + bytes(0x40000) + os.urandom(0x3456)
+    files['small'] = os.urandom(1000)
+
+    check_call('rm -rf %s; mkdir -p %s' % (src_dir, src_dir), shell=True)
+    for name, data in files.items():
+        with open(os.path.join(src_dir, name), 'wb') as fd:
+            if name == 'sparse':
+                # leave a real hole rather than writing the zeroes
+                fd.write(data[:0x5000])
+                fd.seek(0x45000)
+                fd.write(data[0x45000:])
+            else:
+                fd.write(data)
+
+    return files
+
+def check_read(cons, name, data, offset=0, length=0):
+    """Load a file or part of it and check it against the original data.
+
+    Args:
+        cons: U-Boot console.
+        name: File to load.
+        data: Whole contents of the file.
+        offset: Position to start loading from.
+        length: Number of bytes to load, 0 for the rest of the file.
+    """
+    want = data[offset:offset + length] if length else data[offset:]
+    cmd = 'load host 0 %x /%s' % (ADDR, name)
+    if length or offset:
+        cmd += ' %x %x' % (length, offset)
+    output = cons.run_command_list([
+        cmd,
+        'md5sum %x %x' % (ADDR, len(want))])
+    assert('%d bytes read' % len(want) in ''.join(output))
+    assert(hashlib.md5(want).hexdigest() in ''.join(output))
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_btrfs')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.requiredtool('mkfs.btrfs')
+@pytest.mark.parametrize('compress', ['', 'zlib', 'zstd'])
+def test_btrfs_read(u_boot_console, compress):
+    """Read files from a btrfs image created with the given compression."""
+    cons = u_boot_console
+    src_dir = cons.config.persistent_data_dir + '/btrfs_src'
+    fs_img = cons.config.persistent_data_dir + '/btrfs.img'
+    files = make_files(src_dir)
+
+    try:
+        check_call('rm -f %s; truncate -s 128M %s' % (fs_img, fs_img),
+                   shell=True)
+        opts = '--compress %s' % compress if compress else ''
+        try:
+            check_call('mkfs.btrfs -q -f %s --rootdir %s %s'
+                       % (opts, src_dir, fs_img), shell=True)
+        except CalledProcessError:
+            pytest.skip('mkfs.btrfs cannot create this image: %s' % opts)
+
+        cons.run_command('host bind 0 %s' % fs_img)
+
+        for name, data in files.items():
+            check_read(cons, name, data)
+
+        # Reads which start inside an extent, some crossing into the next
+        check_read(cons, 'random', files['random'], 0x12345, 0x123456)
+        check_read(cons, 'text', files['text'], 0x30123, 0x4321)
+        check_read(cons, 'text', files['text'], 0x1ff00, 0x40200)
+        check_read(cons, 'text', files['text'], 0x100001)
+
+        # Reads starting before, inside and after the hole
+        check_read(cons, 'sparse', files['sparse'], 0x4000, 0x2000)
+        check_read(cons, 'sparse', files['sparse'], 0x10000, 0x40000)
+        check_read(cons, 'sparse', files['sparse'], 0x45001)
+    finally:
+        call('rm -rf %s %s' % (src_dir, fs_img), shell=True)
@@ -0,0 +1,90 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: ext4 extent test
+
+"""
+This test reads a sparse ext4 file whose extents do not fit in the inode, so
+that they are looked up through an extent tree, and checks whole and partial
+reads against the original data.
+"""
+
+import hashlib
+import os
+import pytest
+from subprocess import call, check_call
+
+# Data chunks are written every CHUNK_STRIDE bytes, leaving holes between
+CHUNK_COUNT = 24
+CHUNK_STRIDE = 0x10000
+CHUNK_SIZE = 0x1800
+FILE_SIZE = CHUNK_COUNT * CHUNK_STRIDE + 0x123
+
+def make_sparse_file(path):
+    """Write a file with data chunks separated by holes.
+
+    Args:
+        path: File to create.
+    """
+    with open(path, 'wb') as fd:
+        for i in range(CHUNK_COUNT):
+            # Vary the start within the block, so chunks end mid-block
+            fd.seek(i * CHUNK_STRIDE + (i % 3) * 0x100)
+            fd.write(os.urandom(CHUNK_SIZE))
+        fd.truncate(FILE_SIZE)
+
+def md5_range(path, offset, length):
+    """Calculate the md5 of part of a file.
+
+    Args:
+        path: File to read.
+        offset: Offset of the first byte.
+        length: Number of bytes.
+
+    Return:
+        The md5 as a hex string.
+    """
+    with open(path, 'rb') as fd:
+        fd.seek(offset)
+        return hashlib.md5(fd.read(length)).hexdigest()
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_ext4')
+@pytest.mark.requiredtool('mkfs.ext4')
+def test_ext4_extents(u_boot_console):
+    """Read a sparse file mapped by a two-level extent tree."""
+    cons = u_boot_console
+    src_dir = cons.config.persistent_data_dir + '/ext4_extents'
+    src_file = src_dir + '/sparse'
+    fs_img = cons.config.persistent_data_dir + '/ext4_extents.img'
+    addr = 0x01000008
+
+    check_call('rm -rf %s; mkdir -p %s' % (src_dir, src_dir), shell=True)
+    make_sparse_file(src_file)
+    try:
+        # 1KiB blocks give more extents than the four held in the inode
+        check_call('dd if=/dev/zero of=%s bs=1M count=8 2> /dev/null'
+                   % fs_img, shell=True)
+        check_call('mkfs.ext4 -q -b 1024 -d %s %s' % (src_dir, fs_img),
+                   shell=True)
+
+        cons.run_command('host bind 0 %s' % fs_img)
+
+        # Whole file, including the holes and the partial last block
+        output = cons.run_command_list([
+            'ext4load host 0 %x /sparse' % addr,
+            'md5sum %x $filesize' % addr,
+            'setenv filesize'])
+        assert('%d bytes read' % FILE_SIZE in ''.join(output))
+        assert(md5_range(src_file, 0, FILE_SIZE) in ''.join(output))
+
+        # Reads starting in a hole, in the middle of an extent and in the
+        # last extent
+        for offset, length in [(0x3000, 0x20000), (0x20400, 0x45678),
+                               (FILE_SIZE - 0x10100, 0x10100)]:
+            output = cons.run_command_list([
+                'ext4load host 0 %x /sparse %x %x' % (addr, length, offset),
+                'md5sum %x %x' % (addr, length)])
+            assert('%d bytes read' % length in ''.join(output))
+            assert(md5_range(src_file, offset, length) in ''.join(output))
+    finally:
+        call('rm -rf %s %s' % (src_dir, fs_img), shell=True)
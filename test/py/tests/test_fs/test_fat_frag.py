@@ -0,0 +1,59 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: FAT fragmented file test
+
+"""
+This test reads FAT files made of several cluster runs, to destinations
+which are aligned and not aligned for DMA.
+"""
+
+import hashlib
+import os
+import pytest
+from subprocess import call, check_call, CalledProcessError
+
+ADDR = 0x01000000
+LOAD_ADDR = 0x02000000
+PART = 0x5000
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fat')
+@pytest.mark.buildconfigspec('fat_write')
+@pytest.mark.buildconfigspec('cmd_md5sum')
+@pytest.mark.requiredtool('mkfs.vfat')
+@pytest.mark.parametrize('fat', ['16', '32'])
+def test_fat_frag(u_boot_console, fat):
+    """Interleave writes to two files, so that the first one is stored in
+    two cluster runs with the second file in between, then read it back."""
+    cons = u_boot_console
+    fs_img = '%s/fat_frag%s.img' % (cons.config.persistent_data_dir, fat)
+    src = '%s/fat_frag.bin' % cons.config.persistent_data_dir
+    data = os.urandom(2 * PART)
+    with open(src, 'wb') as fd:
+        fd.write(data)
+
+    try:
+        check_call('rm -f %s; truncate -s 64M %s' % (fs_img, fs_img),
+                   shell=True)
+        try:
+            check_call('mkfs.vfat -F %s %s' % (fat, fs_img), shell=True)
+        except CalledProcessError:
+            pytest.skip('mkfs.vfat cannot create a FAT%s image' % fat)
+
+        output = cons.run_command_list([
+            'host bind 0 %s' % fs_img,
+            'load hostfs - %x %s' % (ADDR, src),
+            'fatwrite host 0:0 %x /frag %x' % (ADDR, PART),
+            'fatwrite host 0:0 %x /other %x' % (ADDR, PART),
+            'fatwrite host 0:0 %x /frag %x %x' % (ADDR + PART, PART, PART)])
+        assert('%d bytes written' % PART in output[-1])
+
+        for addr in [LOAD_ADDR, LOAD_ADDR + 1]:
+            output = cons.run_command_list([
+                'mw.b %x 00 %x' % (addr, 2 * PART),
+                'fatload host 0:0 %x /frag' % addr,
+                'md5sum %x %x' % (addr, 2 * PART)])
+            assert('%d bytes read' % (2 * PART) in ''.join(output))
+            assert(hashlib.md5(data).hexdigest() in ''.join(output))
+    finally:
+        call('rm -f %s %s' % (fs_img, src), shell=True)
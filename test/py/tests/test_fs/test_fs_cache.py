@@ -0,0 +1,110 @@
+# SPDX-License-Identifier:      GPL-2.0+
+#
+# U-Boot File System: filesystem cache test
+
+"""
+This test checks that repeated lookups are answered from the filesystem
+cache, and that the cache is dropped when the device is written or removed.
+"""
+
+import os
+import pytest
+import re
+from subprocess import call, check_call
+
+ADDR = 0x01000000
+
+def make_image(cons, name, size):
+    """Create an ext4 image holding a file /f of the given size.
+
+    Args:
+        cons: U-Boot console.
+        name: Prefix of the image and source directory names.
+        size: Size of /f in bytes.
+
+    Return:
+        Path of the image.
+    """
+    src_dir = '%s/%s' % (cons.config.persistent_data_dir, name)
+    fs_img = src_dir + '.img'
+    check_call('rm -rf %s; mkdir -p %s' % (src_dir, src_dir), shell=True)
+    with open(src_dir + '/f', 'wb') as fd:
+        fd.write(os.urandom(size))
+    check_call('dd if=/dev/zero of=%s bs=1M count=4 2> /dev/null' % fs_img,
+               shell=True)
+    check_call('mkfs.ext4 -q -d %s %s' % (src_dir, fs_img), shell=True)
+    call('rm -rf %s' % src_dir, shell=True)
+    return fs_img
+
+def blk_accesses(cons):
+    """Return the block cache hits and misses since the last call.
+
+    Args:
+        cons: U-Boot console.
+
+    Return:
+        Number of block reads seen by the block cache.
+    """
+    output = cons.run_command('blkcache show')
+    hits = int(re.search(r'hits: (\d+)', output).group(1))
+    misses = int(re.search(r'misses: (\d+)', output).group(1))
+    return hits + misses
+
+def get_size(cons, path):
+    """Run the size command and return the filesize variable it set.
+
+    Args:
+        cons: U-Boot console.
+        path: File to look up.
+
+    Return:
+        The output of printenv filesize.
+    """
+    output = cons.run_command_list([
+        'setenv filesize',
+        'size host 0 %s' % path,
+        'printenv filesize'])
+    return ''.join(output)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('fs_cache')
+@pytest.mark.buildconfigspec('cmd_block_cache')
+@pytest.mark.buildconfigspec('cmd_ext4_write')
+@pytest.mark.requiredtool('mkfs.ext4')
+def test_fs_cache(u_boot_console):
+    """Test cache hits, invalidation on write and on device removal."""
+    cons = u_boot_console
+    img1 = make_image(cons, 'fs_cache1', 0x1000)
+    img2 = make_image(cons, 'fs_cache2', 0x2000)
+    try:
+        # The first lookup probes and reads the filesystem
+        cons.run_command('host bind 0 %s' % img1)
+        blk_accesses(cons)
+        assert('filesize=1000' in get_size(cons, '/f'))
+        probe = blk_accesses(cons)
+        assert(probe > 0)
+
+        # A cached lookup does not read the filesystem
+        assert('filesize=1000' in get_size(cons, '/f'))
+        assert(blk_accesses(cons) < probe)
+
+        # A missing file is cached for 'test -e', until the device is written
+        cons.run_command('test -e host 0 /g')
+        blk_accesses(cons)
+        output = cons.run_command('test -e host 0 /g || echo missing')
+        assert('missing' in output)
+        assert(blk_accesses(cons) < probe)
+
+        # Other commands still report a missing file the same way each time
+        first = get_size(cons, '/g')
+        assert('not defined' in first)
+        assert(get_size(cons, '/g') == first)
+        output = cons.run_command('ext4write host 0 %x /g 100' % ADDR)
+        assert('256 bytes written' in output)
+        assert('filesize=100' in get_size(cons, '/g'))
+
+        # Binding another image removes the device, which drops its cache
+        cons.run_command('host bind 0 %s' % img2)
+        assert('filesize=2000' in get_size(cons, '/f'))
+    finally:
+        call('rm -f %s %s' % (img1, img2), shell=True)
@@ -0,0 +1,148 @@
+# SPDX-License-Identifier: GPL-2.0
+#
+# Test reading SquashFS files made of many data blocks, sparse blocks and
+# shared fragments, and that cached metadata is not reused across images.
+
+import hashlib
+import os
+import shutil
+import subprocess
+import pytest
+
+from sqfs_common import check_mksquashfs_version
+
+# Data block size of the test images
+BLOCK_SIZE = 0x10000
+
+# Source directories, image names and mksquashfs options
+IMAGES = [
+        ('sqfs_read_src1', 'sqfs_read_gzip', '-comp gzip'),
+        ('sqfs_read_src2', 'sqfs_read_zstd', '-comp zstd'),
+]
+
+ADDR = '$kernel_addr_r'
+
+def compressible(size, salt):
+    """ Returns numbered lines of text, which mksquashfs stores compressed.
+
+    Args:
+        size: number of bytes to return.
+        salt: bytes added to every line, so that images differ.
+    """
+    lines = (b'%08d %s\n' % (i, salt) for i in range(size // 10 + 1))
+    return b''.join(lines)[:size]
+
+def generate_files(root):
+    """ Generates the files of a test image.
+
+    - big: random data spanning several 1MiB batches, with a tail fragment.
+      Random data does not compress, so its blocks are stored as they are.
+    - text: compressible data over several blocks, with a tail fragment
+    - sparse: random blocks separated by blocks of zeroes
+    - small0 to small7: small compressible files, which share a fragment
+      block with the tails, so that the fragment block is compressed too
+
+    Args:
+        root: directory to create.
+
+    Returns:
+        A dict of file names and their contents.
+    """
+    salt = os.urandom(8).hex().encode()
+    files = {}
+    files['big'] = os.urandom(3 * 0x100000 + 0x345)
+    files['text'] = compressible(5 * BLOCK_SIZE + 0x321, salt)
+    files['sparse'] = b''.join([os.urandom(BLOCK_SIZE) if i % 3 else
+                                bytes(BLOCK_SIZE) for i in range(20)])
+    for i in range(8):
+        files['small%d' % i] = compressible(700 + i, salt + b'%d' % i)
+
+    os.makedirs(root)
+    for name, data in files.items():
+        with open(os.path.join(root, name), 'wb') as fd:
+            fd.write(data)
+
+    return files
+
+def check_file(u_boot_console, name, data, size=None):
+    """ Loads a file and checks its checksum.
+
+    Args:
+        u_boot_console: provides the means to interact with U-Boot's console.
+        name: file to load.
+        data: expected contents of the whole file.
+        size: number of bytes to load, or None to load the whole file.
+    """
+    cmd = 'sqfsload host 0 {} {}'.format(ADDR, name)
+    if size:
+        cmd += ' {:x}'.format(size)
+        data = data[:size]
+    out = u_boot_console.run_command(cmd)
+    assert '{} bytes read'.format(len(data)) in out
+
+    out = u_boot_console.run_command('md5sum {} {:x}'.format(ADDR, len(data)))
+    assert out.split()[-1] == hashlib.md5(data).hexdigest()
+
+def check_image(u_boot_console, files):
+    """ Loads every file of the bound image, in several ways.
+
+    Args:
+        u_boot_console: provides the means to interact with U-Boot's console.
+        files: dict of file names and their contents.
+    """
+    check_file(u_boot_console, 'big', files['big'])
+    # stop in the middle of a batch, and in the middle of a block
+    check_file(u_boot_console, 'big', files['big'], 0x150000)
+    check_file(u_boot_console, 'big', files['big'], BLOCK_SIZE + 0x123)
+    check_file(u_boot_console, 'text', files['text'])
+    # a partial block is decompressed aside and then copied
+    check_file(u_boot_console, 'text', files['text'], 2 * BLOCK_SIZE + 0x77)
+    check_file(u_boot_console, 'sparse', files['sparse'])
+
+    # twice, so the second pass uses the cached fragment block
+    for _ in range(2):
+        for i in range(8):
+            name = 'small%d' % i
+            check_file(u_boot_console, name, files[name])
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fs_generic')
+@pytest.mark.buildconfigspec('cmd_squashfs')
+@pytest.mark.buildconfigspec('fs_squashfs')
+@pytest.mark.buildconfigspec('zstd')
+@pytest.mark.requiredtool('mksquashfs')
+def test_sqfs_read(u_boot_console):
+    """ Reads files from two images in turn.
+
+    Both images hold the same file names with different contents, so stale
+    cached tables or fragments from the other image would give the wrong
+    data. Sandbox host devices complete block requests asynchronously, so
+    the big file is read with the next batch read ahead of the current one.
+
+    Args:
+        u_boot_console: provides the means to interact with U-Boot's console.
+    """
+    build_dir = u_boot_console.config.build_dir
+    check_mksquashfs_version()
+
+    contents = []
+    try:
+        for src, image, opts in IMAGES:
+            src_path = os.path.join(build_dir, src)
+            shutil.rmtree(src_path, ignore_errors=True)
+            contents.append(generate_files(src_path))
+            subprocess.run(['mksquashfs {} {} -noappend -b {} {}'.format(
+                                src_path, os.path.join(build_dir, image),
+                                BLOCK_SIZE, opts)],
+                           shell=True, check=True, stdout=subprocess.DEVNULL)
+
+        for index in [0, 1, 0]:
+            image_path = os.path.join(build_dir, IMAGES[index][1])
+            u_boot_console.run_command('host bind 0 {}'.format(image_path))
+            check_image(u_boot_console, contents[index])
+    finally:
+        for src, image, opts in IMAGES:
+            shutil.rmtree(os.path.join(build_dir, src), ignore_errors=True)
+            image_path = os.path.join(build_dir, image)
+            if os.path.exists(image_path):
+                os.remove(image_path)